@@ -0,0 +1,70 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string_view>
+
+/// Minimal benchmark harness: runs a workload until it takes long enough, and reports
+/// the time, the allocations and the allocated bytes per operation.
+namespace bench {
+    struct AllocStats {
+        size_t count = 0;
+        size_t bytes = 0;
+    };
+    /// Allocations done by the current thread since the start of the program.
+    auto alloc_stats() -> AllocStats;
+    /// Only the workloads whose name contains this filter are run.
+    auto filter() -> std::string_view;
+
+    template <class T>
+    inline auto do_not_optimize(const T& value) -> void {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void* sink;
+        sink = &value;
+#endif
+    }
+
+    inline auto report(std::string_view name, size_t iterations, std::chrono::nanoseconds elapsed, AllocStats allocs) -> void {
+        auto ops = static_cast<double>(iterations);
+        std::printf("%-48.*s %10.1f ns/op %8.2f allocs/op %10.1f B/op\n",
+            static_cast<int>(name.size()), name.data(),
+            static_cast<double>(elapsed.count()) / ops,
+            static_cast<double>(allocs.count) / ops,
+            static_cast<double>(allocs.bytes) / ops);
+    }
+
+    /// `fn` is called with the index of the operation.
+    template <class Fn>
+    auto run(std::string_view name, Fn&& fn) -> void {
+        using clock = std::chrono::steady_clock;
+        if (name.find(filter()) == std::string_view::npos) {
+            return;
+        }
+        constexpr auto min_duration = std::chrono::milliseconds(200);
+        size_t iterations = 1;
+        while (true) {
+            auto alloc_before = alloc_stats();
+            auto start = clock::now();
+            for (size_t i = 0; i < iterations; ++i) {
+                fn(i);
+            }
+            auto elapsed = clock::now() - start;
+            auto alloc_after = alloc_stats();
+            if (elapsed >= min_duration || iterations >= (size_t(1) << 32)) {
+                report(name, iterations, elapsed, {alloc_after.count - alloc_before.count, alloc_after.bytes - alloc_before.bytes});
+                return;
+            }
+            iterations *= elapsed < min_duration / 10 ? 10 : 2;
+        }
+    }
+
+    auto run_runtime() -> void;
+    auto run_float() -> void;
+    auto run_print() -> void;
+    auto run_deferred() -> void;
+    auto run_chrono() -> void;
+    auto run_bytes() -> void;
+    auto run_parallel() -> void;
+}
@@ -0,0 +1,37 @@
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <cfmt/format.h>
+#include <cfmt/formatter_bytes.h>
+#include <cfmt/formatter_container.h>
+#include "bench.h"
+
+/// Hex dumps of a packet payload, compared to the container formatter and snprintf.
+namespace {
+    auto make_payload() -> std::vector<uint8_t> {
+        std::vector<uint8_t> payload(1500);
+        for (size_t i = 0; i < payload.size(); ++i) {
+            payload[i] = static_cast<uint8_t>(i * 131 + 7);
+        }
+        return payload;
+    }
+}
+
+auto bench::run_bytes() -> void {
+    static const auto payload = make_payload();
+    std::string buffer(payload.size() * 10, '\0');
+
+    run("1500 bytes {:x} / cfmt::format_to bytes", [&](size_t) { do_not_optimize(cfmt::format_to(buffer.data(), "{:x}", cfmt::bytes(payload))); });
+    run("1500 bytes {:.4x} / cfmt::format_to bytes", [&](size_t) { do_not_optimize(cfmt::format_to(buffer.data(), "{:.4x}", cfmt::bytes(payload))); });
+    run("1500 bytes {:#.4x} / cfmt::format_to bytes", [&](size_t) { do_not_optimize(cfmt::format_to(buffer.data(), "{:#.4x}", cfmt::bytes(payload))); });
+    run("1500 bytes {:b} / cfmt::format_to bytes", [&](size_t) { do_not_optimize(cfmt::format_to(buffer.data(), "{:b}", cfmt::bytes(payload))); });
+    run("1500 bytes {:x} / cfmt::format_to container", [&](size_t) { do_not_optimize(cfmt::format_to(buffer.data(), "{:x}", payload)); });
+    run("1500 bytes %02x / snprintf", [&](size_t) {
+        auto out = buffer.data();
+        for (auto byte : payload) {
+            out += std::snprintf(out, 3, "%02x", byte);
+        }
+        do_not_optimize(out);
+    });
+}
@@ -0,0 +1,46 @@
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <version>
+#if defined(__cpp_lib_format)
+#include <format>
+#endif
+#include <cfmt/format.h>
+#include <cfmt/formatter_chrono.h>
+#include "bench.h"
+
+/// Log timestamps, compared to strftime and std::format.
+namespace {
+    const auto start = std::chrono::time_point_cast<std::chrono::microseconds>(std::chrono::system_clock::now());
+
+    /// Timestamps 10 us apart, like the lines of a busy log.
+    auto timestamp(size_t i) -> std::chrono::sys_time<std::chrono::microseconds> {
+        return start + std::chrono::microseconds(i * 10);
+    }
+    auto strftime_timestamp(char* buffer, size_t size, std::chrono::sys_time<std::chrono::microseconds> time) -> size_t {
+        auto seconds = std::chrono::floor<std::chrono::seconds>(time);
+        auto time_t = std::chrono::system_clock::to_time_t(seconds);
+        std::tm tm;
+        gmtime_r(&time_t, &tm);
+        auto written = std::strftime(buffer, size, "%F %T", &tm);
+        written += static_cast<size_t>(std::snprintf(buffer + written, size - written, ".%06lld", static_cast<long long>((time - seconds).count())));
+        return written;
+    }
+}
+
+auto bench::run_chrono() -> void {
+    char buffer[64];
+
+    run("timestamp {:%F %T} / cfmt::format_to", [&](size_t i) { do_not_optimize(cfmt::format_to(buffer, "{:%F %T}", timestamp(i))); });
+    run("timestamp {:%F %T} / cfmt::format_to compiled", [&](size_t i) {
+        do_not_optimize(cfmt::format_to(buffer, cfmt::compiled<"{:%F %T}">, timestamp(i)));
+    });
+    run("timestamp {:%d/%m/%Y %H:%M:%S} / cfmt::format_to", [&](size_t i) {
+        do_not_optimize(cfmt::format_to(buffer, "{:%d/%m/%Y %H:%M:%S}", timestamp(i)));
+    });
+    run("timestamp %F %T / strftime", [&](size_t i) { do_not_optimize(strftime_timestamp(buffer, sizeof(buffer), timestamp(i))); });
+#if defined(__cpp_lib_format)
+    run("timestamp {:%F %T} / std::format_to", [&](size_t i) { do_not_optimize(std::format_to(buffer, "{:%F %T}", timestamp(i))); });
+#endif
+    run("duration {} / cfmt::format_to", [&](size_t i) { do_not_optimize(cfmt::format_to(buffer, "{}", std::chrono::microseconds(i))); });
+}
@@ -0,0 +1,36 @@
+#include <cstdio>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <cfmt/format.h>
+
+/// Instantiates the formatting of every combination of 3 arguments among 6 types.
+/// Build it with and without CFMT_VARIADIC_ARGS to compare the code size and the compile time
+/// of the type-erased arguments against the variadic argument pack.
+namespace {
+    using Types = std::tuple<int, unsigned long, double, float, const char*, std::string>;
+    constexpr size_t type_count = std::tuple_size_v<Types>;
+
+    template <size_t I>
+    auto make_value() {
+        return std::tuple_element_t<I, Types>(std::get<I>(Types{1, 2, 3.5, 4.5f, "five", "six"}));
+    }
+    template <size_t I>
+    auto format_combination() -> size_t {
+        constexpr auto a = I % type_count;
+        constexpr auto b = I / type_count % type_count;
+        constexpr auto c = I / type_count / type_count;
+        return cfmt::format_runtime("{} {:>8} {}", make_value<a>(), make_value<b>(), make_value<c>()).size();
+    }
+    template <size_t... Is>
+    auto format_all(std::index_sequence<Is...>) -> size_t {
+        return (format_combination<Is>() + ...);
+    }
+}
+
+int main()
+{
+    auto size = format_all(std::make_index_sequence<type_count*type_count*type_count>{});
+    std::printf("%zu\n", size);
+    return 0;
+}
@@ -0,0 +1,86 @@
+-- Compiles a generated stress suite and reports the compile time per item.
+-- Usage: xmake run cfmt-compile-bench [count] [format|strlit]
+--   format: `count` constexpr formats (default)
+--   strlit: strlit::Concat, Join and Split of `count` string literals
+import("core.base.option")
+import("core.tool.compiler")
+
+local header = [[
+#include <array>
+#include <utility>
+#include <cfmt/format.h>
+#include <cfmt/formatter_container.h>
+#include <cfmt/formatter_map.h>
+]]
+
+-- format strings and their arguments, `%d` is replaced by the index of the format
+local templates = {
+    {'"Entry {}: {:>12} | {:#x} | {:+08}"', '%d, strlit::String("name%d"), %d, -%d'},
+    {'"{{escaped}} {:b} {:o} {:X}"', '%d, %d, %d'},
+    {'"Array: {} / {:>40}"', 'std::array{%d, %d, 3}, std::array{4, 5, %d}'},
+    {'"Map: {:#x}"', 'std::array{std::pair{strlit::String("key"), %d}, std::pair{strlit::String("abc"), %d}}'},
+    {'"Dynamic: {:>{}}|{:.{}f}"', '%d, 12, %d.25, 3'},
+    {'"Float: {} {:e} {:.3g}"', '%d.5, %d.125, 1.0/(%d+1)'},
+}
+
+function _source(count)
+    local lines = {header}
+    for i = 0, count - 1 do
+        local template = templates[i % #templates + 1]
+        local args = template[2]:gsub("%%d", tostring(i))
+        if i % 2 == 0 then
+            table.insert(lines, string.format("constexpr auto value%d = cfmt::format<%s, %s>();", i, template[1], args))
+        else
+            table.insert(lines, string.format("constexpr auto value%d = cfmt::format<256>(%s, %s);", i, template[1], args))
+        end
+    end
+    table.insert(lines, "int main() { return 0; }")
+    return table.concat(lines, "\n") .. "\n"
+end
+
+function _strlit_source(count)
+    local literals = {}
+    for i = 0, count - 1 do
+        table.insert(literals, string.format('"literal%d"', i))
+    end
+    literals = table.concat(literals, ", ")
+    local lines = {
+        "#include <cfmt/strlit.h>",
+        string.format("constexpr strlit::Concat<%s> concatenated;", literals),
+        string.format('constexpr strlit::Join<", ", %s> joined;', literals),
+        'constexpr strlit::Split<", ", joined> splitted;',
+        string.format('static_assert(splitted[%d] == "literal%d");', count - 1, count - 1),
+        "static_assert(joined.length() == joined.size && concatenated.length() == concatenated.size);",
+        "int main() { return static_cast<int>(concatenated.size + joined.size); }",
+    }
+    return table.concat(lines, "\n") .. "\n"
+end
+
+-- compile time of the source in milliseconds
+function _compile_time(target, sourcefile)
+    local start = os.mclock()
+    compiler.compile(sourcefile, sourcefile .. ".o", {target = target})
+    return os.mclock() - start
+end
+
+function main(target)
+    local arguments = option.get("arguments") or {}
+    local count = tonumber(arguments[1]) or 300
+    local suite = arguments[2] or "format"
+    local dir = path.join(target:autogendir(), "compile_bench")
+    local baseline = path.join(dir, "baseline.cpp")
+    local stress = path.join(dir, "stress.cpp")
+    if suite == "strlit" then
+        io.writefile(baseline, "#include <cfmt/strlit.h>\nint main() { return 0; }\n")
+        io.writefile(stress, _strlit_source(count))
+    else
+        io.writefile(baseline, header .. "int main() { return 0; }\n")
+        io.writefile(stress, _source(count))
+    end
+
+    local baseline_time = _compile_time(target, baseline)
+    local stress_time = _compile_time(target, stress)
+    local item = suite == "strlit" and "string literals" or "constexpr formats"
+    print("%d %s compiled in %d ms (%d ms without them)", count, item, stress_time, baseline_time)
+    print("%.3f ms per item", (stress_time - baseline_time) / count)
+end
@@ -0,0 +1,55 @@
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cfmt/deferred.h>
+#include "bench.h"
+
+namespace {
+    /// Times batches of prints small enough to fit in the ring, the rendering is not timed.
+    template <class Fn>
+    auto run_producer(std::string_view name, cfmt::DeferredPrinter& printer, Fn&& fn) -> void {
+        using clock = std::chrono::steady_clock;
+        if (name.find(bench::filter()) == std::string_view::npos) {
+            return;
+        }
+        constexpr size_t batch = 20000;
+        constexpr size_t batch_count = 50;
+        std::chrono::nanoseconds elapsed{};
+        auto alloc_before = bench::alloc_stats();
+        for (size_t b = 0; b < batch_count; ++b) {
+            auto start = clock::now();
+            for (size_t i = 0; i < batch; ++i) {
+                fn(b*batch + i);
+            }
+            elapsed += clock::now() - start;
+            printer.flush();
+        }
+        auto alloc_after = bench::alloc_stats();
+        bench::report(name, batch*batch_count, elapsed, {alloc_after.count - alloc_before.count, alloc_after.bytes - alloc_before.bytes});
+    }
+}
+
+/// Cost of a deferred print on the calling thread, compared to formatting the line on it.
+auto bench::run_deferred() -> void {
+    auto fd = ::open("/dev/null", O_WRONLY);
+    {
+        cfmt::DeferredPrinter printer(fd, 1 << 22);
+        // creates the ring of the thread
+        printer.print<"">();
+        run_producer("deferred print / producer", printer, [&](size_t i) {
+            do_not_optimize(printer.print<"request {} took {:>6} us: {}\n">(i, i % 1000, "ok"));
+        });
+        run_producer("deferred print / producer with a 64 bytes string", printer, [&](size_t i) {
+            do_not_optimize(printer.print<"request {} from {}\n">(i, "a user supplied name that is exactly sixty-four characters long.."));
+        });
+        if (printer.dropped() != 0) {
+            std::printf("deferred print: %zu prints dropped\n", printer.dropped());
+        }
+    }
+    char buffer[128];
+    run("deferred print / format_to compiled", [&](size_t i) {
+        do_not_optimize(cfmt::format_to(buffer, cfmt::compiled<"request {} took {:>6} us: {}\n">, i, i % 1000, "ok"));
+    });
+    ::close(fd);
+}
@@ -0,0 +1,42 @@
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <cfmt/format.h>
+#include "bench.h"
+
+/// Floating point formatter compared to snprintf and std::to_chars.
+namespace {
+    auto make_values() -> std::vector<double> {
+        std::mt19937_64 rng(42);
+        std::uniform_real_distribution<double> mantissa(1.0, 10.0);
+        std::uniform_int_distribution<int> exponent(-30, 30);
+        std::vector<double> values(1 << 16);
+        for (auto& value : values) {
+            value = mantissa(rng) * std::pow(10.0, exponent(rng));
+        }
+        return values;
+    }
+}
+
+auto bench::run_float() -> void {
+    static const auto values = make_values();
+    auto value = [](size_t i) {
+        return values[i % values.size()];
+    };
+    char buffer[128];
+
+    run("double {} / cfmt::format_to compiled", [&](size_t i) { do_not_optimize(cfmt::format_to(buffer, cfmt::compiled<"{}">, value(i))); });
+    run("double shortest / std::to_chars", [&](size_t i) { do_not_optimize(std::to_chars(buffer, buffer + sizeof(buffer), value(i))); });
+    run("double %.17g / snprintf", [&](size_t i) { do_not_optimize(std::snprintf(buffer, sizeof(buffer), "%.17g", value(i))); });
+
+    run("double {:.17g} / cfmt::format_to compiled", [&](size_t i) { do_not_optimize(cfmt::format_to(buffer, cfmt::compiled<"{:.17g}">, value(i))); });
+    run("double {:.6e} / cfmt::format_to compiled", [&](size_t i) { do_not_optimize(cfmt::format_to(buffer, cfmt::compiled<"{:.6e}">, value(i))); });
+    run("double %.6e / snprintf", [&](size_t i) { do_not_optimize(std::snprintf(buffer, sizeof(buffer), "%.6e", value(i))); });
+    run("double %.6e / std::to_chars", [&](size_t i) {
+        do_not_optimize(std::to_chars(buffer, buffer + sizeof(buffer), value(i), std::chars_format::scientific, 6));
+    });
+    run("double {:.2f} / cfmt::format_to compiled", [&](size_t i) { do_not_optimize(cfmt::format_to(buffer, cfmt::compiled<"{:.2f}">, value(i))); });
+    run("double %.2f / snprintf", [&](size_t i) { do_not_optimize(std::snprintf(buffer, sizeof(buffer), "%.2f", value(i))); });
+}
@@ -0,0 +1,46 @@
+#include <cstdlib>
+#include <new>
+#include "bench.h"
+
+namespace {
+    thread_local bench::AllocStats stats;
+    std::string_view name_filter;
+}
+
+auto bench::alloc_stats() -> AllocStats {
+    return stats;
+}
+auto bench::filter() -> std::string_view {
+    return name_filter;
+}
+
+auto operator new(size_t size) -> void* {
+    ++stats.count;
+    stats.bytes += size;
+    if (auto ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+auto operator delete(void* ptr) noexcept -> void {
+    std::free(ptr);
+}
+auto operator delete(void* ptr, size_t) noexcept -> void {
+    std::free(ptr);
+}
+
+/// Usage: cfmt-bench [filter]
+int main(int argc, char** argv)
+{
+    if (argc > 1) {
+        name_filter = argv[1];
+    }
+    bench::run_runtime();
+    bench::run_float();
+    bench::run_print();
+    bench::run_deferred();
+    bench::run_chrono();
+    bench::run_bytes();
+    bench::run_parallel();
+    return 0;
+}
@@ -0,0 +1,37 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include <cfmt/format.h>
+#include <cfmt/formatter_parallel.h>
+#include "bench.h"
+
+/// Scaling of the parallel formatting of a large range with the number of threads.
+namespace {
+    auto make_values() -> std::vector<int> {
+        std::vector<int> values(size_t(1) << 22);
+        for (size_t i = 0; i < values.size(); ++i) {
+            values[i] = static_cast<int>(i * 2654435761u);
+        }
+        return values;
+    }
+}
+
+auto bench::run_parallel() -> void {
+    static const auto values = make_values();
+    std::string output;
+
+    run("4M int {} / cfmt::format_to serial", [&](size_t) {
+        output.clear();
+        cfmt::format_to(output, "{}", values);
+        do_not_optimize(output.data());
+    });
+    auto max_threads = std::max(2u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        auto name = "4M int {} / cfmt::parallel " + std::to_string(threads) + " threads";
+        run(name, [&](size_t) {
+            output.clear();
+            cfmt::format_to(output, "{}", cfmt::parallel(values, {.threads = threads}));
+            do_not_optimize(output.data());
+        });
+    }
+}
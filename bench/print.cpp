@@ -0,0 +1,34 @@
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <unistd.h>
+#include <cfmt/print.h>
+#include "bench.h"
+
+/// Printing a log line to /dev/null, compared to printf and std::cout.
+auto bench::run_print() -> void {
+    auto fd = ::open("/dev/null", O_WRONLY);
+    auto file = std::fopen("/dev/null", "w");
+    std::ofstream null_stream("/dev/null");
+    auto cout_buffer = std::cout.rdbuf(null_stream.rdbuf());
+
+    run("print line / cfmt::print FILE*", [&](size_t i) { cfmt::print(file, "request {} took {:>6} us: {}\n", i, i % 1000, "ok"); });
+    run("print line / cfmt::print fd", [&](size_t i) { cfmt::print(fd, "request {} took {:>6} us: {}\n", i, i % 1000, "ok"); });
+    {
+        cfmt::PrintBatch batch;
+        run("print line / cfmt::print fd batched", [&](size_t i) { cfmt::print(fd, "request {} took {:>6} us: {}\n", i, i % 1000, "ok"); });
+    }
+    run("print line / cfmt::print fd compiled", [&](size_t i) {
+        cfmt::print(fd, cfmt::compiled<"request {} took {:>6} us: {}\n">, i, i % 1000, "ok");
+    });
+    run("print line / fprintf", [&](size_t i) { std::fprintf(file, "request %zu took %6zu us: %s\n", i, i % 1000, "ok"); });
+    run("print line / std::cout <<", [&](size_t i) {
+        std::cout << "request " << i << " took " << std::setw(6) << i % 1000 << " us: " << "ok" << '\n';
+    });
+
+    std::cout.rdbuf(cout_buffer);
+    std::fclose(file);
+    ::close(fd);
+}
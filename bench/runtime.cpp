@@ -0,0 +1,181 @@
+#include <array>
+#include <cstdio>
+#include <locale>
+#include <string>
+#include <utility>
+#include <version>
+#if defined(__cpp_lib_format)
+#include <format>
+#endif
+#include <cfmt/format.h>
+#include <cfmt/format_cache.h>
+#include <cfmt/formatter_container.h>
+#include <cfmt/formatter_map.h>
+#include <cfmt/formatter_tuple.h>
+#include <cfmt/memory_buffer.h>
+#include "bench.h"
+
+/// Hot paths of format_runtime, compared to snprintf and std::format.
+namespace {
+    constexpr std::array<int, 8> integers = {0, 7, -42, 1234, -56789, 1000000, 2147483647, -2147483647};
+    constexpr std::array<std::string_view, 4> strings = {"a", "hello", "hello world", "a longer string to pad"};
+    constexpr std::array<std::string_view, 4> utf8_strings = {"é", "héllo", "日本語のテキスト", "a longer ascii label with ü"};
+    constexpr auto container = std::array{1, 22, 333, 4444, 55555, 666666, 7777777, 88888888};
+    struct Record {
+        std::string_view name;
+        int id;
+        unsigned count;
+    };
+    constexpr auto record = Record{"request", 1234, 56};
+    constexpr auto map = std::array{std::pair{"alpha", 1}, std::pair{"beta", 22}, std::pair{"gamma", 333}, std::pair{"delta", 4444}};
+
+#if defined(__cpp_lib_format)
+    /// "1,234,567" grouping of std::format, without depending on the installed locales.
+    struct ThousandsGrouping : std::numpunct<char> {
+        auto do_thousands_sep() const -> char override { return ','; }
+        auto do_grouping() const -> std::string override { return "\3"; }
+    };
+#endif
+
+    /// Notification template known at runtime: a few KB of text with a few fields.
+    const auto notification = [] {
+        std::string text;
+        for (int i = 0; i < 64; ++i) {
+            text += "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor. ";
+            if (i % 16 == 0) {
+                text += "{0} ";
+            }
+        }
+        return text;
+    }();
+
+    auto integer(size_t i) -> int {
+        return integers[i % integers.size()];
+    }
+    auto string(size_t i) -> std::string_view {
+        return strings[i % strings.size()];
+    }
+    auto utf8_string(size_t i) -> std::string_view {
+        return utf8_strings[i % utf8_strings.size()];
+    }
+
+    auto snprintf_container(char* buffer, size_t size) -> int {
+        int written = std::snprintf(buffer, size, "{");
+        for (size_t i = 0; i < container.size(); ++i) {
+            written += std::snprintf(buffer + written, size - written, i == 0 ? "%d" : ", %d", container[i]);
+        }
+        written += std::snprintf(buffer + written, size - written, "}");
+        return written;
+    }
+    auto snprintf_map(char* buffer, size_t size) -> int {
+        int written = std::snprintf(buffer, size, "{");
+        for (size_t i = 0; i < map.size(); ++i) {
+            written += std::snprintf(buffer + written, size - written, i == 0 ? "%s: %#x" : ", %s: %#x", map[i].first, map[i].second);
+        }
+        written += std::snprintf(buffer + written, size - written, "}");
+        return written;
+    }
+}
+
+auto bench::run_runtime() -> void {
+    char buffer[256];
+
+    run("int {} / cfmt::format_runtime", [](size_t i) { do_not_optimize(cfmt::format_runtime("{}", integer(i))); });
+    run("int {} / cfmt::format_to compiled", [&](size_t i) { do_not_optimize(cfmt::format_to(buffer, cfmt::compiled<"{}">, integer(i))); });
+    run("int {} / snprintf", [&](size_t i) { do_not_optimize(std::snprintf(buffer, sizeof(buffer), "%d", integer(i))); });
+#if defined(__cpp_lib_format)
+    run("int {} / std::format", [](size_t i) { do_not_optimize(std::format("{}", integer(i))); });
+#endif
+
+    cfmt::set_digit_grouping(cfmt::DigitGrouping::uniform(',', 3));
+    run("int {:L} / cfmt::format_runtime", [](size_t i) { do_not_optimize(cfmt::format_runtime("{:L}", integer(i))); });
+    run("int {:L} / cfmt::format_to compiled", [&](size_t i) { do_not_optimize(cfmt::format_to(buffer, cfmt::compiled<"{:L}">, integer(i))); });
+#if defined(__cpp_lib_format)
+    auto grouped_locale = std::locale(std::locale::classic(), new ThousandsGrouping);
+    run("int {:L} / std::format", [&](size_t i) { do_not_optimize(std::format(grouped_locale, "{:L}", integer(i))); });
+#endif
+
+    run("int {:#x} / cfmt::format_runtime", [](size_t i) { do_not_optimize(cfmt::format_runtime("{:#x}", integer(i))); });
+    run("int {:#x} / snprintf", [&](size_t i) { do_not_optimize(std::snprintf(buffer, sizeof(buffer), "%#x", integer(i))); });
+#if defined(__cpp_lib_format)
+    run("int {:#x} / std::format", [](size_t i) { do_not_optimize(std::format("{:#x}", integer(i))); });
+#endif
+
+    run("int {:o} / cfmt::format_runtime", [](size_t i) { do_not_optimize(cfmt::format_runtime("{:o}", integer(i))); });
+    run("int {:o} / snprintf", [&](size_t i) { do_not_optimize(std::snprintf(buffer, sizeof(buffer), "%o", integer(i))); });
+#if defined(__cpp_lib_format)
+    run("int {:o} / std::format", [](size_t i) { do_not_optimize(std::format("{:o}", integer(i))); });
+#endif
+
+    run("int {:b} / cfmt::format_runtime", [](size_t i) { do_not_optimize(cfmt::format_runtime("{:b}", integer(i))); });
+#if defined(__cpp_lib_format)
+    run("int {:b} / std::format", [](size_t i) { do_not_optimize(std::format("{:b}", integer(i))); });
+#endif
+
+    run("string {:>16} / cfmt::format_runtime", [](size_t i) { do_not_optimize(cfmt::format_runtime("{:>16}", string(i))); });
+    run("string {:>16} / snprintf", [&](size_t i) {
+        auto str = string(i);
+        do_not_optimize(std::snprintf(buffer, sizeof(buffer), "%16.*s", static_cast<int>(str.size()), str.data()));
+    });
+#if defined(__cpp_lib_format)
+    run("string {:>16} / std::format", [](size_t i) { do_not_optimize(std::format("{:>16}", string(i))); });
+#endif
+
+    run("utf-8 string {:>32} / cfmt::format_to compiled", [&](size_t i) {
+        do_not_optimize(cfmt::format_to(buffer, cfmt::compiled<"{:>32}">, utf8_string(i)));
+    });
+#if defined(__cpp_lib_format)
+    run("utf-8 string {:>32} / std::format", [](size_t i) { do_not_optimize(std::format("{:>32}", utf8_string(i))); });
+#endif
+
+    run("array<int, 8> {} / cfmt::format_runtime", [](size_t) { do_not_optimize(cfmt::format_runtime("{}", container)); });
+    run("array<int, 8> {} / cfmt::memory_buffer", [](size_t) {
+        cfmt::memory_buffer<128> buffer;
+        cfmt::format_to(buffer, "{}", container);
+        do_not_optimize(buffer.size());
+    });
+    run("array<int, 8> {} / cfmt::pmr::format_runtime arena", [](size_t) {
+        std::byte arena[256];
+        std::pmr::monotonic_buffer_resource resource(arena, sizeof(arena));
+        do_not_optimize(cfmt::pmr::format_runtime(&resource, "{}", container));
+    });
+    run("array<int, 8> {} / snprintf", [&](size_t) { do_not_optimize(snprintf_container(buffer, sizeof(buffer))); });
+
+    run("struct {} / cfmt::format_to compiled", [&](size_t) { do_not_optimize(cfmt::format_to(buffer, cfmt::compiled<"{}">, record)); });
+    run("struct {} / snprintf", [&](size_t) {
+        do_not_optimize(std::snprintf(buffer, sizeof(buffer), "{%.*s, %d, %u}", static_cast<int>(record.name.size()), record.name.data(), record.id, record.count));
+    });
+
+    run("positional {} {} / cfmt::format_to compiled", [&](size_t i) {
+        do_not_optimize(cfmt::format_to(buffer, cfmt::compiled<"{} took {}ms">, string(i), integer(i)));
+    });
+    run("named {user} {latency} / cfmt::format_to compiled", [&](size_t i) {
+        do_not_optimize(cfmt::format_to(buffer, cfmt::compiled<"{user} took {latency}ms">, cfmt::arg<"user">(string(i)), cfmt::arg<"latency">(integer(i))));
+    });
+    run("named {user} {latency} / cfmt::format_runtime", [](size_t i) {
+        do_not_optimize(cfmt::format_runtime("{user} took {latency}ms", cfmt::arg<"user">(string(i)), cfmt::arg<"latency">(integer(i))));
+    });
+
+    std::string output;
+    run("5 KB runtime template / cfmt::format_to", [&](size_t i) {
+        output.clear();
+        cfmt::format_to(output, std::string_view(notification), integer(i));
+        do_not_optimize(output.size());
+    });
+
+    auto order = std::string("Hello {}, your order #{} of {:>8} items ships on {}, {{see the tracking page}}.");
+    run("runtime order template / cfmt::format_runtime", [&](size_t i) {
+        do_not_optimize(cfmt::format_runtime(std::string_view(order), string(i), integer(i), i, "monday"));
+    });
+    cfmt::format_cache cache;
+    run("runtime order template / cfmt::format_cache lookup", [&](size_t i) {
+        do_not_optimize(cfmt::format_runtime(cache.get(order), string(i), integer(i), i, "monday"));
+    });
+    auto cached_order = cache.get(order);
+    run("runtime order template / cfmt::cached_format", [&](size_t i) {
+        do_not_optimize(cfmt::format_runtime(cached_order, string(i), integer(i), i, "monday"));
+    });
+
+    run("pair map {:#x} / cfmt::format_runtime", [](size_t) { do_not_optimize(cfmt::format_runtime("{:#x}", map)); });
+    run("pair map {:#x} / snprintf", [&](size_t) { do_not_optimize(snprintf_map(buffer, sizeof(buffer))); });
+}
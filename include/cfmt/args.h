@@ -0,0 +1,275 @@
+#pragma once
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include "formatter.h"
+#include "sink.h"
+#include "strlit.h"
+
+namespace cfmt
+{
+    /// Type-erased reference to a sink.
+    class SinkRef {
+    public:
+        template <IsSink Sink>
+        SinkRef(Sink& sink) noexcept
+            : m_sink(&sink)
+            , m_append([](void* sink, std::string_view str) { static_cast<Sink*>(sink)->append(str); })
+            , m_fill([](void* sink, size_t count, char ch) { static_cast<Sink*>(sink)->append(count, ch); })
+            , m_reserve([](void* sink, size_t count) { details::reserve(*static_cast<Sink*>(sink), count); })
+            , m_append_buffer([](void* sink, size_t count) { return details::append_buffer(*static_cast<Sink*>(sink), count); })
+        {}
+        SinkRef(SinkRef& other) noexcept = default;
+        SinkRef(const SinkRef& other) noexcept = default;
+
+        auto append(std::string_view str) -> SinkRef& {
+            m_append(m_sink, str);
+            return *this;
+        }
+        auto append(size_t count, char ch) -> SinkRef& {
+            m_fill(m_sink, count, ch);
+            return *this;
+        }
+        /// Reserves room for `count` more characters.
+        auto reserve(size_t count) -> void {
+            m_reserve(m_sink, count);
+        }
+        /// Appends `count` characters to be written in place, see `details::append_buffer`.
+        auto append_buffer(size_t count) -> char* {
+            return m_append_buffer(m_sink, count);
+        }
+    private:
+        void* m_sink;
+        void (*m_append)(void*, std::string_view);
+        void (*m_fill)(void*, size_t, char);
+        void (*m_reserve)(void*, size_t);
+        char* (*m_append_buffer)(void*, size_t);
+    };
+
+    /// Argument referenced by its name in the format string, eg `{user}`. See `cfmt::arg`.
+    template <strlit::StringType Name, class T>
+    struct NamedArg {
+        static constexpr std::string_view name = Name.sv();
+        const T& value;
+    };
+    /// Names the argument for the format string: `cfmt::format_runtime("{user}: {0}", cfmt::arg<"user">(name))`.
+    /// The name is part of the type, so the compiled and checked format strings resolve it at compile time.
+    template <strlit::StringType Name, class T>
+    constexpr auto arg(const T& value) -> NamedArg<Name, T> {
+        return {value};
+    }
+
+    namespace details {
+        template <class T>
+        struct IsNamedArgT : std::false_type {};
+        template <strlit::StringType Name, class T>
+        struct IsNamedArgT<NamedArg<Name, T>> : std::true_type {};
+        template <class T>
+        concept IsNamedArg = IsNamedArgT<std::remove_cvref_t<T>>::value;
+
+        /// Value of the argument, unwrapped from its name.
+        template <class T>
+        constexpr auto unwrap_named(const T& value) -> const auto& {
+            if constexpr (IsNamedArg<T>) {
+                return value.value;
+            } else {
+                return value;
+            }
+        }
+        /// Type of the value of the argument.
+        template <class T>
+        using UnnamedType = std::remove_cvref_t<decltype(unwrap_named(std::declval<const T&>()))>;
+
+        /// Names of the arguments in order, empty for the positional ones.
+        using ArgNames = std::span<const std::string_view>;
+        template <class T>
+        constexpr auto arg_name() -> std::string_view {
+            if constexpr (IsNamedArg<T>) {
+                return std::remove_cvref_t<T>::name;
+            } else {
+                return {};
+            }
+        }
+        template <class... Args>
+        inline constexpr std::array<std::string_view, sizeof...(Args)> arg_names = {arg_name<Args>()...};
+    }
+
+    namespace details {
+        enum class ArgType : uint8_t {
+            none,
+            int64,
+            uint64,
+            float32,
+            float64,
+            string,
+            custom,
+        };
+        template <class T>
+        constexpr auto arg_type_of() -> ArgType {
+            if constexpr (std::signed_integral<T>) {
+                return ArgType::int64;
+            } else if constexpr (std::unsigned_integral<T>) {
+                return ArgType::uint64;
+            } else if constexpr (std::same_as<T, float>) {
+                return ArgType::float32;
+            } else if constexpr (std::floating_point<T>) {
+                return ArgType::float64;
+            } else if constexpr (std::convertible_to<const T&, std::string_view>) {
+                return ArgType::string;
+            } else {
+                return ArgType::custom;
+            }
+        }
+    }
+
+    class FormatArgs;
+    namespace details {
+        /// Formats the argument of a custom type, checking its spec if `check_spec` is true.
+        template <class T>
+        auto format_custom(const void* value, std::string_view format, SinkRef& sink, const FormatArgs& args, bool check_spec) -> void;
+        using CustomFormatFn = void (*)(const void*, std::string_view, SinkRef&, const FormatArgs&, bool);
+    }
+
+    /// Type-erased argument: built-in types are stored by value, other types by address
+    /// along with the function formatting them.
+    class FormatArg {
+    public:
+        FormatArg() noexcept = default;
+        template <strlit::StringType Name, class T>
+        explicit FormatArg(const NamedArg<Name, T>& named) noexcept : FormatArg(named.value) {}
+        template <class T>
+            requires (!std::same_as<T, FormatArg> && !details::IsNamedArg<T>)
+        explicit FormatArg(const T& value) noexcept : m_type(details::arg_type_of<T>()) {
+            if constexpr (details::arg_type_of<T>() == details::ArgType::int64) {
+                m_int = static_cast<int64_t>(value);
+            } else if constexpr (details::arg_type_of<T>() == details::ArgType::uint64) {
+                m_uint = static_cast<uint64_t>(value);
+            } else if constexpr (details::arg_type_of<T>() == details::ArgType::float32) {
+                m_float = value;
+            } else if constexpr (details::arg_type_of<T>() == details::ArgType::float64) {
+                m_double = static_cast<double>(value);
+            } else if constexpr (details::arg_type_of<T>() == details::ArgType::string) {
+                auto str = std::string_view(value);
+                m_string = {str.data(), str.size()};
+            } else {
+                m_custom.value = &value;
+                m_custom.format = &details::format_custom<T>;
+            }
+        }
+
+        auto type() const noexcept -> details::ArgType {
+            return m_type;
+        }
+        /// Integer value of the argument if it is an integer. Throws `format_error` if it does not fit in an `int64_t`.
+        auto to_integer() const -> std::optional<int64_t> {
+            switch (m_type) {
+                case details::ArgType::int64: return m_int;
+                case details::ArgType::uint64: return details::checked_integer(m_uint);
+                default: return std::nullopt;
+            }
+        }
+        /// Formats the argument with the spec. With `check_spec`, an invalid spec for the type of the argument
+        /// throws `format_error`, for the format strings not checked at compile time.
+        auto format(SinkRef& sink, std::string_view format, const FormatArgs& args, bool check_spec = false) const -> void;
+    private:
+        struct String {
+            const char* data;
+            size_t size;
+        };
+        struct Custom {
+            const void* value;
+            details::CustomFormatFn format;
+        };
+        details::ArgType m_type = details::ArgType::none;
+        union {
+            int64_t m_int = 0;
+            uint64_t m_uint;
+            float m_float;
+            double m_double;
+            String m_string;
+            Custom m_custom;
+        };
+    };
+
+    /// View on the arguments of a format call, looked up by index.
+    class FormatArgs {
+    public:
+        FormatArgs() noexcept = default;
+        template <size_t N>
+        FormatArgs(const std::array<FormatArg, N>& args, details::ArgNames names = {}) noexcept
+            : m_args(args.data()), m_size(N), m_names(names) {}
+
+        auto get(int64_t id) const noexcept -> FormatArg {
+            if (id < 0 || static_cast<size_t>(id) >= m_size) {
+                return FormatArg{};
+            }
+            return m_args[id];
+        }
+        auto size() const noexcept -> size_t {
+            return m_size;
+        }
+        /// Argument at index `id`, which must be in range.
+        auto operator[](int64_t id) const noexcept -> const FormatArg& {
+            return m_args[id];
+        }
+        /// Names of the arguments, used to resolve the named fields of the format strings.
+        auto names() const noexcept -> details::ArgNames {
+            return m_names;
+        }
+        /// Function returning the integer value of an argument, used for dynamic width and precision.
+        /// It throws `format_error` if the argument is not an integer.
+        auto integer_getter() const {
+            return [this](int64_t id) {
+                auto value = get(id).to_integer();
+                if (!value) {
+                    details::ThrowErrors{}("dynamic width or precision must be an integer argument");
+                }
+                return *value;
+            };
+        }
+    private:
+        const FormatArg* m_args = nullptr;
+        size_t m_size = 0;
+        details::ArgNames m_names;
+    };
+
+    template <class T>
+    auto details::format_custom(const void* value, std::string_view format, SinkRef& sink, const FormatArgs& args, bool check_spec) -> void {
+        if (check_spec) {
+            details::format_value<true>(sink, *static_cast<const T*>(value), format, args.integer_getter());
+        } else {
+            details::format_value(sink, *static_cast<const T*>(value), format, args.integer_getter());
+        }
+    }
+
+    inline auto FormatArg::format(SinkRef& sink, std::string_view format, const FormatArgs& args, bool check_spec) const -> void {
+        auto get_integer = args.integer_getter();
+        auto format_value = [&](const auto& value) {
+            if (check_spec) {
+                details::format_value<true>(sink, value, format, get_integer);
+            } else {
+                details::format_value(sink, value, format, get_integer);
+            }
+        };
+        switch (m_type) {
+            case details::ArgType::none: break;
+            case details::ArgType::int64: format_value(m_int); break;
+            case details::ArgType::uint64: format_value(m_uint); break;
+            case details::ArgType::float32: format_value(m_float); break;
+            case details::ArgType::float64: format_value(m_double); break;
+            case details::ArgType::string: format_value(std::string_view(m_string.data, m_string.size)); break;
+            case details::ArgType::custom: m_custom.format(m_custom.value, format, sink, args, check_spec); break;
+        }
+    }
+
+    /// Stores the arguments of a format call. The arguments must outlive the returned array.
+    template <class... Args>
+    auto make_format_args(const Args&... args) noexcept -> std::array<FormatArg, sizeof...(Args)> {
+        return {FormatArg(args)...};
+    }
+}
@@ -0,0 +1,350 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <vector>
+#include "print.h"
+
+namespace cfmt
+{
+    /// Specialize to true for a trivially copyable type to defer its values: it must hold them,
+    /// not refer to them, since the record is rendered after the print returns.
+    template <class T>
+    inline constexpr bool enable_deferred = false;
+
+    namespace details {
+        template <class T>
+        struct IsChronoValueT : std::false_type {};
+        template <class Rep, class Period>
+        struct IsChronoValueT<std::chrono::duration<Rep, Period>> : std::is_arithmetic<Rep> {};
+        template <class Clock, class Duration>
+        struct IsChronoValueT<std::chrono::time_point<Clock, Duration>> : IsChronoValueT<Duration> {};
+
+        /// Strings are copied into the record. Other arguments are copied as is, so they are limited to
+        /// the types holding their value: arithmetic, enum and chrono types, and the ones enabled with `enable_deferred`.
+        /// Pointers, views and named arguments only hold a reference, so they are not deferrable.
+        template <class T>
+        concept IsDeferredString = std::convertible_to<const T&, std::string_view>;
+        template <class T>
+        concept IsDeferredValue = std::is_arithmetic_v<T> || std::is_enum_v<T> || IsChronoValueT<T>::value
+            || (enable_deferred<T> && std::is_trivially_copyable_v<T>);
+        template <class T>
+        concept IsDeferrable = !IsNamedArg<T> && (IsDeferredString<T> || IsDeferredValue<T>);
+
+        /// Type of the argument when it is decoded from the record.
+        template <class T>
+        using DeferredType = std::conditional_t<IsDeferredString<T>, std::string_view, T>;
+
+        template <IsDeferrable T>
+        auto deferred_size(const T& value) -> size_t {
+            if constexpr (IsDeferredString<T>) {
+                return sizeof(uint32_t) + std::string_view(value).size();
+            } else {
+                return sizeof(T);
+            }
+        }
+        template <IsDeferrable T>
+        auto encode_deferred(std::byte* it, const T& value) -> std::byte* {
+            if constexpr (IsDeferredString<T>) {
+                auto str = std::string_view(value);
+                auto size = static_cast<uint32_t>(str.size());
+                std::memcpy(it, &size, sizeof(size));
+                std::memcpy(it + sizeof(size), str.data(), str.size());
+                return it + sizeof(size) + str.size();
+            } else {
+                std::memcpy(it, std::addressof(value), sizeof(T));
+                return it + sizeof(T);
+            }
+        }
+        template <IsDeferrable T>
+        auto decode_deferred(const std::byte*& it) -> DeferredType<T> {
+            if constexpr (IsDeferredString<T>) {
+                uint32_t size;
+                std::memcpy(&size, it, sizeof(size));
+                auto str = std::string_view(reinterpret_cast<const char*>(it + sizeof(size)), size);
+                it += sizeof(size) + size;
+                return str;
+            } else {
+                std::array<std::byte, sizeof(T)> bytes;
+                std::memcpy(bytes.data(), it, sizeof(T));
+                it += sizeof(T);
+                return std::bit_cast<T>(bytes);
+            }
+        }
+
+        /// Renders the arguments of a record. Its address identifies the format string and the argument types.
+        using DeferredDecodeFn = void (*)(const std::byte*, SinkRef);
+        template <strlit::StringType Str, class... Args>
+        auto decode_record([[maybe_unused]] const std::byte* data, SinkRef sink) -> void {
+            // braced initialization decodes the arguments in order
+            auto values = std::tuple<DeferredType<Args>...>{decode_deferred<Args>(data)...};
+            std::apply([&](const auto&... args) {
+                vformat_to(sink, compiled<Str>, args...);
+            }, values);
+        }
+
+        struct alignas(16) DeferredHeader {
+            /// size of the record, header included
+            uint64_t size;
+            /// nullptr for the padding skipping the end of the ring
+            DeferredDecodeFn decode;
+        };
+
+        /// Lock-free ring of records with a single producer and a single consumer.
+        /// Records are contiguous: the end of the ring is skipped when a record does not fit in it.
+        class DeferredRing {
+        public:
+            static constexpr size_t alignment = sizeof(DeferredHeader);
+
+            explicit DeferredRing(size_t capacity)
+                : m_capacity(std::bit_ceil(std::max(capacity, alignment*4)))
+                , m_data(std::make_unique<std::byte[]>(m_capacity))
+            {}
+
+            /// Returns the memory of a record of `size` bytes, or nullptr when the ring is full.
+            auto reserve(size_t size) -> std::byte* {
+                auto record_size = (sizeof(DeferredHeader) + size + alignment - 1) / alignment * alignment;
+                auto offset = m_head & (m_capacity - 1);
+                auto skipped = offset + record_size > m_capacity ? m_capacity - offset : 0;
+                if (record_size + skipped > m_capacity - (m_head - m_cached_tail)) {
+                    m_cached_tail = m_tail.load(std::memory_order_acquire);
+                    if (record_size + skipped > m_capacity - (m_head - m_cached_tail)) {
+                        m_dropped.fetch_add(1, std::memory_order_relaxed);
+                        return nullptr;
+                    }
+                }
+                if (skipped != 0) {
+                    auto padding = DeferredHeader{skipped, nullptr};
+                    std::memcpy(m_data.get() + offset, &padding, sizeof(padding));
+                    offset = 0;
+                }
+                m_record_size = record_size;
+                m_skipped = skipped;
+                return m_data.get() + offset;
+            }
+            /// Publishes the record returned by the last `reserve`.
+            auto commit(std::byte* record, DeferredDecodeFn decode) -> void {
+                auto header = DeferredHeader{m_record_size, decode};
+                std::memcpy(record, &header, sizeof(header));
+                m_head += m_skipped + m_record_size;
+                m_published.store(m_head, std::memory_order_release);
+            }
+            /// Renders the published records and returns their count.
+            auto consume(SinkRef sink) -> size_t {
+                auto tail = m_tail.load(std::memory_order_relaxed);
+                auto head = m_published.load(std::memory_order_acquire);
+                size_t count = 0;
+                while (tail != head) {
+                    DeferredHeader header;
+                    std::memcpy(&header, m_data.get() + (tail & (m_capacity - 1)), sizeof(header));
+                    if (header.decode != nullptr) {
+                        header.decode(m_data.get() + (tail & (m_capacity - 1)) + sizeof(header), sink);
+                        ++count;
+                    }
+                    tail += header.size;
+                }
+                m_tail.store(tail, std::memory_order_release);
+                return count;
+            }
+            auto dropped() const -> size_t {
+                return m_dropped.load(std::memory_order_relaxed);
+            }
+            /// Called by the producer when its thread exits: no record is published after it.
+            auto retire() -> void {
+                m_retired.store(true, std::memory_order_release);
+            }
+            auto retired() const -> bool {
+                return m_retired.load(std::memory_order_acquire);
+            }
+        private:
+            size_t m_capacity;
+            std::unique_ptr<std::byte[]> m_data;
+            // producer side
+            alignas(64) size_t m_head = 0;
+            size_t m_cached_tail = 0;
+            size_t m_record_size = 0;
+            size_t m_skipped = 0;
+            std::atomic<size_t> m_published = 0;
+            std::atomic<size_t> m_dropped = 0;
+            std::atomic<bool> m_retired = false;
+            // consumer side
+            alignas(64) std::atomic<size_t> m_tail = 0;
+        };
+    }
+
+    /// Prints without formatting on the calling thread: the arguments are copied with the identifier
+    /// of the format string into a ring of the thread, and a background thread renders them.
+    /// The order of the prints is kept for each thread, not between threads.
+    /// When the ring of a thread is full, its prints are dropped instead of waiting.
+    class DeferredPrinter {
+    public:
+        static constexpr size_t default_ring_capacity = 1 << 16;
+
+        explicit DeferredPrinter(int fd, size_t ring_capacity = default_ring_capacity)
+            : DeferredPrinter(details::PrintTarget{nullptr, fd}, ring_capacity)
+        {}
+        explicit DeferredPrinter(std::FILE* file, size_t ring_capacity = default_ring_capacity)
+            : DeferredPrinter(details::PrintTarget{file, -1}, ring_capacity)
+        {}
+        DeferredPrinter(const DeferredPrinter&) = delete;
+        auto operator=(const DeferredPrinter&) -> DeferredPrinter& = delete;
+        ~DeferredPrinter() {
+            {
+                std::lock_guard lock(m_mutex);
+                m_stop = true;
+            }
+            m_wake.notify_all();
+            m_thread.join();
+        }
+
+        /// Copies the arguments into the ring of the thread. Returns false if the print is dropped.
+        template <strlit::StringType Str, details::IsDeferrable... Args>
+        auto print(const Args&... args) -> bool {
+            auto& ring = thread_ring();
+            auto record = ring.reserve((details::deferred_size(args) + ... + 0));
+            if (record == nullptr) {
+                return false;
+            }
+            [[maybe_unused]] auto it = record + sizeof(details::DeferredHeader);
+            ((it = details::encode_deferred(it, args)), ...);
+            ring.commit(record, &details::decode_record<Str, Args...>);
+            return true;
+        }
+        /// Waits until the prints done before the call are written.
+        auto flush() -> void {
+            std::unique_lock lock(m_mutex);
+            auto target = m_passes + 2;
+            m_wake.notify_all();
+            m_drained.wait(lock, [&] { return m_passes >= target || m_stop; });
+        }
+        /// Number of prints dropped because a ring was full.
+        auto dropped() const -> size_t {
+            std::lock_guard lock(m_mutex);
+            auto count = m_retired_dropped;
+            for (const auto& ring : m_rings) {
+                count += ring->dropped();
+            }
+            return count;
+        }
+    private:
+        DeferredPrinter(details::PrintTarget target, size_t ring_capacity)
+            : m_target(target)
+            , m_ring_capacity(ring_capacity)
+            , m_id(next_id().fetch_add(1, std::memory_order_relaxed))
+            , m_thread([this] { run(); })
+        {}
+
+        static auto next_id() -> std::atomic<uint64_t>& {
+            static std::atomic<uint64_t> id = 1;
+            return id;
+        }
+        /// Rings of a thread, retired when the thread exits so the printers drain and drop them.
+        struct ThreadRings {
+            std::vector<std::pair<uint64_t, std::shared_ptr<details::DeferredRing>>> rings;
+
+            ThreadRings() = default;
+            ThreadRings(const ThreadRings&) = delete;
+            auto operator=(const ThreadRings&) -> ThreadRings& = delete;
+            ~ThreadRings() {
+                for (const auto& [id, ring] : rings) {
+                    ring->retire();
+                }
+            }
+        };
+        /// Ring of the calling thread, created on its first print.
+        auto thread_ring() -> details::DeferredRing& {
+            // identifiers are never reused, so the rings of the destroyed printers are never looked up
+            thread_local ThreadRings thread_rings;
+            for (const auto& [id, ring] : thread_rings.rings) {
+                if (id == m_id) {
+                    return *ring;
+                }
+            }
+            // the rings only referenced by the thread belong to destroyed printers
+            std::erase_if(thread_rings.rings, [](const auto& entry) { return entry.second.use_count() == 1; });
+            std::lock_guard lock(m_mutex);
+            auto ring = std::make_shared<details::DeferredRing>(m_ring_capacity);
+            m_rings.push_back(ring);
+            m_rings_changed = true;
+            thread_rings.rings.emplace_back(m_id, ring);
+            return *ring;
+        }
+        auto run() -> void {
+            auto& out = details::print_buffer();
+            out.set_target(m_target);
+            std::vector<std::shared_ptr<details::DeferredRing>> rings;
+            std::vector<const details::DeferredRing*> drained;
+            std::unique_lock lock(m_mutex);
+            while (true) {
+                auto stop = m_stop;
+                if (m_rings_changed) {
+                    rings = m_rings;
+                    m_rings_changed = false;
+                }
+                lock.unlock();
+                size_t count = 0;
+                out.begin_batch();
+                for (const auto& ring : rings) {
+                    // a ring retired before it is consumed has no record left after it
+                    auto retired = ring->retired();
+                    count += ring->consume(out);
+                    if (retired) {
+                        drained.push_back(ring.get());
+                    }
+                }
+                out.end_batch();
+                if (m_target.file != nullptr) {
+                    std::fflush(m_target.file);
+                }
+                lock.lock();
+                if (!drained.empty()) {
+                    std::erase_if(m_rings, [&](const auto& ring) {
+                        if (std::find(drained.begin(), drained.end(), ring.get()) == drained.end()) {
+                            return false;
+                        }
+                        m_retired_dropped += ring->dropped();
+                        return true;
+                    });
+                    rings = m_rings;
+                    m_rings_changed = false;
+                    drained.clear();
+                }
+                ++m_passes;
+                m_drained.notify_all();
+                if (stop) {
+                    return;
+                }
+                if (count == 0) {
+                    m_wake.wait_for(lock, std::chrono::milliseconds(1));
+                }
+            }
+        }
+
+        details::PrintTarget m_target;
+        size_t m_ring_capacity;
+        uint64_t m_id;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_drained;
+        std::vector<std::shared_ptr<details::DeferredRing>> m_rings;
+        bool m_rings_changed = false;
+        /// prints dropped by the rings of the exited threads
+        size_t m_retired_dropped = 0;
+        uint64_t m_passes = 0;
+        bool m_stop = false;
+        std::thread m_thread;
+    };
+}
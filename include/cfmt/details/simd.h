@@ -0,0 +1,13 @@
+#pragma once
+/// Vector instructions available to the runtime paths of the headers. AVX2 is tested with `__AVX2__`,
+/// `CFMT_SSE2` and `CFMT_NEON` are defined when SSE2 or the NEON of aarch64 are available.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CFMT_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define CFMT_NEON
+#endif
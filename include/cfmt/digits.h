@@ -0,0 +1,92 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace cfmt::details {
+    inline constexpr char digits_lower[] = "0123456789abcdef";
+    inline constexpr char digits_upper[] = "0123456789ABCDEF";
+    /// "00", "01", ..., "99" packed together
+    inline constexpr auto digit_pairs = [] {
+        std::array<char, 200> result{};
+        for (size_t i = 0; i < 100; ++i) {
+            result[i*2] = static_cast<char>('0' + i / 10);
+            result[i*2+1] = static_cast<char>('0' + i % 10);
+        }
+        return result;
+    }();
+    inline constexpr auto powers_of_10 = [] {
+        std::array<uint64_t, 20> result{};
+        uint64_t value = 1;
+        for (auto& power : result) {
+            power = value;
+            value *= 10;
+        }
+        return result;
+    }();
+
+    /// Unsigned type used to write the digits of an integer of type T.
+    template <std::integral T>
+    using UnsignedFor = std::conditional_t<(sizeof(T) <= sizeof(uint32_t)), uint32_t, uint64_t>;
+
+    /// Absolute value of the integer, valid for the minimum value of signed types.
+    template <std::integral T>
+    constexpr auto magnitude(T value) -> UnsignedFor<T> {
+        using U = UnsignedFor<T>;
+        if constexpr (std::signed_integral<T>) {
+            if (value < 0) {
+                return static_cast<U>(U(0) - static_cast<U>(value));
+            }
+        }
+        return static_cast<U>(value);
+    }
+
+    /// Number of decimal digits of `value` (1 for 0).
+    constexpr auto count_digits(uint64_t value) -> size_t {
+        // log10(2) ~= 1233/4096
+        value |= 1;
+        auto t = (static_cast<size_t>(std::bit_width(value)) * 1233) >> 12;
+        return t + 1 - (value < powers_of_10[t]);
+    }
+    /// Number of digits of `value` in base 2^shift (1 for 0).
+    constexpr auto count_digits(uint64_t value, int shift) -> size_t {
+        return (static_cast<size_t>(std::bit_width(value | 1)) + shift - 1) / shift;
+    }
+
+    /// Writes the decimal digits at `begin` and returns the end of the digits.
+    template <std::unsigned_integral U>
+    constexpr auto write_decimal(char* begin, U value) -> char* {
+        auto end = begin + count_digits(value);
+        auto it = end;
+        while (value >= 100) {
+            auto pair = static_cast<size_t>(value % 100) * 2;
+            value /= 100;
+            *--it = digit_pairs[pair+1];
+            *--it = digit_pairs[pair];
+        }
+        if (value >= 10) {
+            auto pair = static_cast<size_t>(value) * 2;
+            *--it = digit_pairs[pair+1];
+            *--it = digit_pairs[pair];
+        } else {
+            *--it = static_cast<char>('0' + value);
+        }
+        return end;
+    }
+    /// Writes the digits in base 2^shift at `begin` and returns the end of the digits.
+    template <std::unsigned_integral U>
+    constexpr auto write_power_of_2(char* begin, U value, int shift, bool upper) -> char* {
+        const char* digits = upper ? digits_upper : digits_lower;
+        const U mask = static_cast<U>((U(1) << shift) - 1);
+        auto end = begin + count_digits(value, shift);
+        auto it = end;
+        do {
+            *--it = digits[value & mask];
+            value >>= shift;
+        } while (value != 0);
+        return end;
+    }
+}
@@ -2,121 +2,756 @@
 #include <cstddef>
 #include <string_view>
 #include <string>
-#include <vector>
+#include <algorithm>
+#include <utility>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <memory>
 #include <optional>
 #include <concepts>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 #include "strlit.h"
 #include "utils.h"
 #include "formatter.h"
+#include "sink.h"
+#include "args.h"
+#include "instrument.h"
+#include "details/simd.h"
 
 namespace cfmt 
 {
+    class cached_format;
+
     namespace details {
 
-        struct Token {
-            int64_t id=-1;
-            std::string format;
-            constexpr Token(int64_t id, std::string_view format) : id(id), format(format) {}
-            constexpr Token(std::string_view format) : format(format) {}
-            constexpr Token(std::string&& format) : format(std::move(format)) {}
-            constexpr auto  is_arg() const {
-                return id != -1;
+        /// Replaces the automatic indices and the names of the nested fields of `spec` (eg "{:{}}", "{:{width}}")
+        /// by explicit indices, and calls `fn` with the resulting spec. Specs without nested fields are passed as is.
+        constexpr auto with_indexed_nested_fields(std::string_view spec, auto&& get_index, auto&& fn) -> void {
+            auto pos = spec.find('{');
+            if (pos == std::string_view::npos) {
+                fn(spec);
+                return;
             }
-        };
-        constexpr auto parse(std::string_view text) {
-            std::vector<Token> result;
+            // each nested field grows by at most the 19 digits of an index
+            char buffer[128];
+            std::string long_buffer;
+            char* begin = buffer;
+            if (spec.size() + 19*std::count(spec.begin(), spec.end(), '{') > sizeof(buffer)) {
+                long_buffer.resize(spec.size() + 19*std::count(spec.begin(), spec.end(), '{'));
+                begin = long_buffer.data();
+            }
+            auto it = begin;
+            size_t prev_pos = 0;
+            for (; pos != std::string_view::npos; pos = spec.find('{', prev_pos)) {
+                auto end = spec.find('}', pos);
+                if (end == std::string_view::npos) {
+                    break;
+                }
+                it = std::copy(spec.begin() + prev_pos, spec.begin() + pos + 1, it);
+                auto field = spec.substr(pos + 1, end - pos - 1);
+                if (!field.empty() && field.find_first_not_of("0123456789") == std::string_view::npos) {
+                    it = std::copy(field.begin(), field.end(), it);
+                } else {
+                    it = write_decimal(it, static_cast<uint64_t>(get_index(field)));
+                }
+                prev_pos = end;
+            }
+            it = std::copy(spec.begin() + prev_pos, spec.end(), it);
+            fn(std::string_view(begin, static_cast<size_t>(it - begin)));
+        }
+        /// Position of the first '{' or '}' of the text from `pos`, or the size of the text.
+        /// At runtime the literal text is skipped a vector, then a word at a time.
+        constexpr auto find_brace(std::string_view text, size_t pos) -> size_t {
+            if (!std::is_constant_evaluated()) {
+                auto begin = text.data();
+                auto it = begin + pos;
+                auto end = begin + text.size();
+#if defined(__AVX2__)
+                auto open = _mm256_set1_epi8('{');
+                auto close = _mm256_set1_epi8('}');
+                for (; end - it >= 32; it += 32) {
+                    auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+                    auto braces = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, open), _mm256_cmpeq_epi8(chunk, close));
+                    if (auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(braces)); mask != 0) {
+                        return static_cast<size_t>(it - begin) + static_cast<size_t>(std::countr_zero(mask));
+                    }
+                }
+#elif defined(CFMT_SSE2)
+                auto open = _mm_set1_epi8('{');
+                auto close = _mm_set1_epi8('}');
+                for (; end - it >= 16; it += 16) {
+                    auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+                    auto braces = _mm_or_si128(_mm_cmpeq_epi8(chunk, open), _mm_cmpeq_epi8(chunk, close));
+                    if (auto mask = static_cast<uint32_t>(_mm_movemask_epi8(braces)); mask != 0) {
+                        return static_cast<size_t>(it - begin) + static_cast<size_t>(std::countr_zero(mask));
+                    }
+                }
+#elif defined(CFMT_NEON)
+                auto open = vdupq_n_u8('{');
+                auto close = vdupq_n_u8('}');
+                for (; end - it >= 16; it += 16) {
+                    auto chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(it));
+                    if (vmaxvq_u8(vorrq_u8(vceqq_u8(chunk, open), vceqq_u8(chunk, close))) != 0) {
+                        break;
+                    }
+                }
+#endif
+                constexpr uint64_t ones = 0x0101010101010101u;
+                auto has_zero_byte = [](uint64_t word) {
+                    return ((word - ones) & ~word & (ones * 0x80)) != 0;
+                };
+                for (; end - it >= 8; it += 8) {
+                    uint64_t word;
+                    std::memcpy(&word, it, sizeof(word));
+                    if (has_zero_byte(word ^ (ones * '{')) || has_zero_byte(word ^ (ones * '}'))) {
+                        break;
+                    }
+                }
+                pos = static_cast<size_t>(it - begin);
+            }
+            while (pos < text.size() && text[pos] != '{' && text[pos] != '}') {
+                ++pos;
+            }
+            return pos;
+        }
+        inline constexpr const char* unknown_name_error = "unknown argument name in format string";
+        /// Parses the format text without allocating, and calls `on_token(id, text)` for each token
+        /// in order: literals have the id -1 and their text, fields have their argument index and their spec.
+        /// Literals may be split around escaped braces.
+        /// `on_error(message)` is called for the malformed fields, which are then kept as text or dropped.
+        /// Named fields are resolved to the index of their name in `names`.
+        constexpr auto parse_to(std::string_view text, auto&& on_token, auto&& on_error, ArgNames names = {}) -> void {
             int32_t level=0;
             size_t prev_pos = 0;
             uint32_t current_index = 0;
-            auto get_index = [&](std::optional<std::string_view> str) {
-                if (str && !str->empty()) {
-                    return cfmt::utils::sv_to_int(*str);
+            auto get_index = [&](std::string_view str) {
+                if (!str.empty()) {
+                    if (str.find_first_not_of("0123456789") == std::string_view::npos) {
+                        return cfmt::utils::sv_to_int(str);
+                    }
+                    for (size_t i = 0; i < names.size(); ++i) {
+                        if (names[i] == str) {
+                            return static_cast<int64_t>(i);
+                        }
+                    }
+                    on_error(str[0] >= '0' && str[0] <= '9' ? "invalid argument index in format string" : unknown_name_error);
+                    return int64_t(0);
                 }
                 return static_cast<int64_t>(current_index++);
             };
-            auto add_string_to_last = [&](auto... to_add) {
-                if (result.empty()) {
-                    result.emplace_back(std::string(to_add...));
+            auto literal = [&](size_t end) {
+                if (end > prev_pos) {
+                    on_token(int64_t(-1), text.substr(prev_pos, end-prev_pos));
                 }
-                auto& last = result.back();
-                last.format.append(to_add...);
             };
-            for(size_t pos = 0;pos<text.length();pos++) {
+            for (size_t pos = find_brace(text, 0); pos < text.length(); pos = find_brace(text, pos+1)) {
                 auto ch = text[pos];
                 if (ch == '{') {
                     if (level == 0) {
                         if (pos < text.length()-1 && text[pos+1] == '{') {
-                            add_string_to_last('{', 1);
+                            literal(pos+1);
+                            prev_pos = ++pos + 1;
                             continue;
                         }
-                        result.emplace_back(std::move(text.substr(prev_pos, pos-prev_pos)));
+                        literal(pos);
+                        prev_pos = pos+1;
                     }
                     level++;
-                    prev_pos = pos+1;
                 } else if (ch == '}') {
-                    if (level == 0 && pos < text.length()-1 && text[pos+1] != '}') {
-                        add_string_to_last('}', 1);
+                    if (level == 0) {
+                        literal(pos+1);
+                        if (pos < text.length()-1 && text[pos+1] == '}') {
+                            ++pos;
+                        } else {
+                            on_error("unmatched '}' in format string");
+                        }
+                        prev_pos = pos+1;
                         continue;
                     }
                     level--;
                     if (level == 0) {
                         auto arg = text.substr(prev_pos, pos-prev_pos);
-                        auto pos = arg.find(':');
-                        if (pos == std::string::npos) {
-                            result.push_back(Token{get_index(std::nullopt), std::string()});
+                        auto colon = arg.find(':');
+                        auto id = get_index(arg.substr(0, colon));
+                        if (colon == std::string_view::npos) {
+                            on_token(id, std::string_view{});
                         } else {
-                            result.push_back(Token{get_index(arg.substr(0, pos)), std::string(arg.substr(pos+1))});
+                            with_indexed_nested_fields(arg.substr(colon+1), get_index, [&](std::string_view spec) {
+                                on_token(id, spec);
+                            });
                         }
-                    } else if (level < 0) {
-                        // throw std::runtime_error("Unmatched '}'");
+                        prev_pos = pos+1;
                     }
-                    prev_pos = pos+1;
                 }
             }
-            if (prev_pos != text.length()) {
-                result.push_back(std::string(text.substr(prev_pos)));
+            if (level == 0) {
+                literal(text.length());
+            } else {
+                on_error("unmatched '{' in format string");
             }
-            return result;
+        }
+        struct IgnoreErrors {
+            constexpr auto operator()(const char*) const -> void {}
+        };
+        constexpr auto parse_to(std::string_view text, auto&& on_token) -> void {
+            parse_to(text, on_token, IgnoreErrors{});
         }
     }
 
-    constexpr auto format_runtime(std::string_view format_text, auto... args) -> std::string {
-        auto parsed = details::parse(format_text);
-        std::string result;
-        for (auto& arg : parsed) {
-            if (!arg.is_arg()) {
-                result.append(arg.format);
-            } else {
-                // if (arg.id >= sizeof...(args)) {
-                    // throw std::runtime_error("Not enough arguments");
-                // }
-                arg.format = format_runtime(std::string_view{arg.format}, args...);
-
-                int i=0;
-                ([&result, &arg, &i](auto&& arg_value) mutable {
-                    using formatter_t = Formatter<std::remove_cvref_t<decltype(arg_value)>>;
-                    if (i++ == arg.id) {
-                        auto formatter = formatter_t{};
-                        auto descriptor = formatter.parse(arg.format);
-                        result.append(formatter.format(arg_value, descriptor));
+    namespace details {
+        /// Define CFMT_VARIADIC_ARGS to format at runtime directly from the argument pack
+        /// instead of the type-erased arguments.
+#if defined(CFMT_VARIADIC_ARGS)
+        inline constexpr bool use_variadic_args = true;
+#else
+        inline constexpr bool use_variadic_args = false;
+#endif
+        /// Value of the argument at index `id`, which must be an integer.
+        constexpr auto arg_integer(int64_t id, const auto&... args) -> int64_t {
+            std::optional<int64_t> result;
+            int64_t i=0;
+            ([&result, id, &i](const auto& arg_value) {
+                if (i++ != id) {
+                    return false;
+                }
+                if constexpr (std::integral<UnnamedType<decltype(arg_value)>>) {
+                    result = checked_integer(unwrap_named(arg_value));
+                }
+                return true;
+            }(args) || ...);
+            if (!result) {
+                ThrowErrors{}("dynamic width or precision must be an integer argument");
+            }
+            return *result;
+        }
+        /// Formats the argument at index `id`. With `CheckSpec`, its spec is checked while parsed (see `parse_spec`).
+        template <bool CheckSpec, IsSink Sink>
+        constexpr auto format_arg(Sink& sink, int64_t id, std::string_view format, const auto&... args) {
+            if (id >= static_cast<int64_t>(sizeof...(args))) {
+                ThrowErrors{}("argument index out of range");
+            }
+            if constexpr (sizeof...(args) > 0) {
+                auto get_integer = [&](int64_t integer_id) {
+                    return arg_integer(integer_id, args...);
+                };
+                int64_t i=0;
+                ([&sink, id, format, &i, &get_integer](const auto& arg_value) {
+                    if (i++ == id) {
+                        format_value<CheckSpec>(sink, unwrap_named(arg_value), format, get_integer);
                         return true;
                     }
                     return false;
                 }(args) || ...);
             }
         }
+    }
+
+    namespace details {
+        /// Formats the argument of a format string not checked at compile time: its spec is checked while parsed.
+        inline auto format_unchecked_arg(SinkRef& sink, int64_t id, std::string_view spec, const FormatArgs& args) -> void {
+            if (static_cast<size_t>(id) >= args.size()) {
+                ThrowErrors{}("argument index out of range");
+            }
+            args[id].format(sink, spec, args, true);
+        }
+        /// Formatting core on type-erased arguments, instantiated once for every argument types.
+        /// Throws `format_error` if the format string is invalid. Not usable in constant evaluation.
+        inline auto vformat(SinkRef sink, std::string_view format_text, FormatArgs args) -> void {
+            parse_to(format_text, [&](int64_t id, std::string_view text) {
+                if (id == -1) {
+                    sink.append(text);
+                } else {
+                    format_unchecked_arg(sink, id, text, args);
+                }
+            }, ThrowErrors{}, args.names());
+        }
+        /// Formatting core for the format strings checked at compile time.
+        inline auto vformat_checked(SinkRef sink, std::string_view format_text, FormatArgs args) -> void {
+            parse_to(format_text, [&](int64_t id, std::string_view text) {
+                if (id == -1) {
+                    sink.append(text);
+                } else {
+                    args[id].format(sink, text, args);
+                }
+            }, IgnoreErrors{}, args.names());
+        }
+        /// Formatting core on the argument pack, used in constant evaluation.
+        /// The specs are checked if the format string was not checked at compile time.
+        template <bool CheckSpecs, IsSink Sink>
+        constexpr auto vformat_variadic(Sink& sink, std::string_view format_text, const auto&... args) -> void {
+            parse_to(format_text, [&](int64_t id, std::string_view text) {
+                if (id == -1) {
+                    sink.append(text);
+                    return;
+                }
+                format_arg<CheckSpecs>(sink, id, text, args...);
+            }, ThrowErrors{}, arg_names<std::remove_cvref_t<decltype(args)>...>);
+        }
+        template <IsSink Sink>
+        constexpr auto vformat_to(Sink& sink, std::string_view format_text, const auto&... args) -> void {
+            instrumented(sink, format_text, [&](auto& out) {
+                if (!std::is_constant_evaluated() && !use_variadic_args) {
+                    auto store = make_format_args(args...);
+                    vformat(out, format_text, {store, arg_names<std::remove_cvref_t<decltype(args)>...>});
+                } else {
+                    vformat_variadic<true>(out, format_text, args...);
+                }
+            });
+        }
+    }
+
+    namespace details {
+        /// Functions named after the errors of the format strings checked at compile time. They are not constexpr,
+        /// so the build fails on the call to the one of the error, and the diagnostic shows its name.
+        namespace format_errors {
+            auto argument_index_out_of_range() -> void;
+            auto invalid_argument_index_in_format_string() -> void;
+            auto unknown_argument_name_in_format_string() -> void;
+            auto duplicate_argument_name() -> void;
+            auto unmatched_opening_brace_in_format_string() -> void;
+            auto unmatched_closing_brace_in_format_string() -> void;
+            auto dynamic_width_or_precision_must_be_an_integer_argument() -> void;
+            auto invalid_format_spec() -> void;
+            auto precision_is_too_big() -> void;
+            auto invalid_presentation_type_for_the_argument() -> void;
+            auto only_fill_alignment_width_and_range_spec_apply_to_tuples() -> void;
+            auto missing_conversion_specifier_after_percent() -> void;
+            auto invalid_conversion_specifier_for_the_argument() -> void;
+            auto invalid_format_string() -> void;
+        }
+        constexpr auto report_format_error(std::string_view message) -> void {
+            using namespace format_errors;
+            constexpr std::pair<std::string_view, void (*)()> errors[] = {
+                {"argument index out of range", &argument_index_out_of_range},
+                {"invalid argument index in format string", &invalid_argument_index_in_format_string},
+                {unknown_name_error, &unknown_argument_name_in_format_string},
+                {"duplicate argument name", &duplicate_argument_name},
+                {"unmatched '{' in format string", &unmatched_opening_brace_in_format_string},
+                {"unmatched '}' in format string", &unmatched_closing_brace_in_format_string},
+                {"dynamic width or precision must be an integer argument", &dynamic_width_or_precision_must_be_an_integer_argument},
+                {"invalid format spec", &invalid_format_spec},
+                {"precision is too big", &precision_is_too_big},
+                {"invalid presentation type for the argument", &invalid_presentation_type_for_the_argument},
+                {"only the fill, the alignment, the width and the range spec apply to tuples", &only_fill_alignment_width_and_range_spec_apply_to_tuples},
+                {"missing conversion specifier after '%'", &missing_conversion_specifier_after_percent},
+                {"invalid conversion specifier for the argument", &invalid_conversion_specifier_for_the_argument},
+            };
+            for (auto [text, fn] : errors) {
+                if (text == message) {
+                    fn();
+                    return;
+                }
+            }
+            invalid_format_string();
+        }
+        /// Checks the format string against the types of the arguments.
+        /// Returns the error message, or nullptr if the format string is valid.
+        template <class... Args>
+        constexpr auto check_format(std::string_view text) -> const char* {
+            constexpr bool is_integer[] = {std::integral<UnnamedType<Args>>..., false};
+            constexpr std::array<const char* (*)(std::string_view), sizeof...(Args)> check_specs = {&check_spec<UnnamedType<Args>>...};
+            constexpr auto& names = arg_names<std::remove_cvref_t<Args>...>;
+            for (size_t i = 0; i < names.size(); ++i) {
+                for (size_t j = 0; j < i; ++j) {
+                    if (!names[i].empty() && names[i] == names[j]) {
+                        return "duplicate argument name";
+                    }
+                }
+            }
+            const char* error = nullptr;
+            auto check_integer = [&](const std::optional<int64_t>& id) {
+                if (id && (*id >= static_cast<int64_t>(sizeof...(Args)) || !is_integer[*id])) {
+                    error = "dynamic width or precision must be an integer argument";
+                }
+            };
+            parse_to(text, [&](int64_t id, std::string_view spec) {
+                if (id == -1 || error != nullptr) {
+                    return;
+                }
+                if (id >= static_cast<int64_t>(sizeof...(Args))) {
+                    error = "argument index out of range";
+                    return;
+                }
+                FormatDescriptor desc;
+                desc.parse(spec.begin(), spec.end());
+                check_integer(desc.width_arg);
+                check_integer(desc.precision_arg);
+                if (error == nullptr) {
+                    error = check_specs[id](spec);
+                }
+            }, [&](const char* message) {
+                if (error == nullptr) {
+                    error = message;
+                }
+            }, names);
+            return error;
+        }
+    }
+
+    /// Format string checked at compile time against the types of the arguments.
+    /// Invalid format strings fail the build, so formatting with it does not check anything.
+    template <class... Args>
+    struct basic_format_string {
+        template <class S>
+            requires std::convertible_to<const S&, std::string_view>
+        consteval basic_format_string(const S& text) : str(text) {
+            if (auto error = details::check_format<Args...>(str)) {
+                details::report_format_error(error);
+            }
+        }
+        std::string_view str;
+    };
+    /// The arguments are not deduced from the format string, and their references and qualifiers are ignored.
+    template <class... Args>
+    using format_string = basic_format_string<std::remove_cvref_t<Args>...>;
+
+    namespace details {
+        template <class... Args>
+        constexpr auto vformat_to(IsSink auto& sink, const basic_format_string<Args...>& format_text, const auto&... args) -> void {
+            instrumented(sink, format_text.str, [&](auto& out) {
+                if (!std::is_constant_evaluated() && !use_variadic_args) {
+                    auto store = make_format_args(args...);
+                    vformat_checked(out, format_text.str, {store, arg_names<Args...>});
+                } else {
+                    vformat_variadic<false>(out, format_text.str, args...);
+                }
+            });
+        }
+    }
+
+    /// Formats with a format string checked at compile time.
+    template <class... Args>
+    constexpr auto format_runtime(format_string<Args...> format_text, const Args&... args) -> std::string {
+        std::string result;
+        details::vformat_to(result, format_text, args...);
+        return result;
+    }
+    /// Formats with a format string known at runtime. Throws `format_error` if it is invalid.
+    template <class S>
+        requires std::convertible_to<const S&, std::string_view> && (!std::is_array_v<S>)
+    constexpr auto format_runtime(const S& format_text, const auto&... args) -> std::string {
+        std::string result;
+        details::vformat_to(result, std::string_view(format_text), args...);
+        return result;
+    }
+
+    namespace details {
+        struct CompiledToken {
+            int64_t id = -1;
+            size_t offset = 0;
+            size_t size = 0;
+            constexpr auto is_arg() const {
+                return id != -1;
+            }
+        };
+        /// Calls `on_token(id, text, merged)` like `parse_to`, `merged` is true for the literals
+        /// following another literal. Returns the number of merged tokens and the total size of their texts.
+        constexpr auto parse_merged(std::string_view text, auto&& on_token, ArgNames names = {}) -> std::pair<size_t, size_t> {
+            size_t count = 0;
+            size_t size = 0;
+            bool previous_literal = false;
+            parse_to(text, [&](int64_t id, std::string_view token_text) {
+                auto literal = id == -1;
+                on_token(id, token_text, literal && previous_literal);
+                count += !(literal && previous_literal);
+                size += token_text.size();
+                previous_literal = literal;
+            }, ThrowErrors{}, names);
+            return {count, size};
+        }
+        /// True if the format string has named fields, which are resolved for the names of the arguments.
+        constexpr auto has_named_fields(std::string_view text) -> bool {
+            bool named = false;
+            parse_to(text, [](int64_t, std::string_view) {}, [&](const char* message) {
+                named = named || std::string_view(message) == unknown_name_error;
+            });
+            return named;
+        }
+
+        /// Format string parsed at compile time, its named fields resolved for the names of `Args`.
+        /// Tokens are stored in a fixed-size array and their texts are packed in a single string,
+        /// so formatting with it only runs the formatters.
+        template <strlit::StringType Str, class... Args>
+        struct ParsedFormat {
+            static constexpr auto counts = parse_merged(Str.sv(), [](int64_t, std::string_view, bool) {}, arg_names<Args...>);
+            static constexpr size_t token_count = counts.first;
+            static constexpr size_t text_size = counts.second;
+            static constexpr auto text = [] {
+                strlit::String<text_size+1> result;
+                auto it = result.text;
+                parse_merged(Str.sv(), [&](int64_t, std::string_view token_text, bool) {
+                    it = std::copy(token_text.begin(), token_text.end(), it);
+                }, arg_names<Args...>);
+                return result;
+            }();
+            static constexpr auto tokens = [] {
+                std::array<CompiledToken, token_count> result;
+                size_t offset = 0;
+                auto it = result.begin();
+                parse_merged(Str.sv(), [&](int64_t id, std::string_view token_text, bool merged) {
+                    if (merged) {
+                        std::prev(it)->size += token_text.size();
+                    } else {
+                        *it++ = CompiledToken{
+                            id, 
+                            offset, 
+                            token_text.size()
+                        };
+                    }
+                    offset += token_text.size();
+                }, arg_names<Args...>);
+                return result;
+            }();
+            static constexpr auto token_text(const CompiledToken& token) -> std::string_view {
+                return text.sv().substr(token.offset, token.size);
+            }
+        };
+        template <strlit::StringType Str>
+        inline constexpr bool is_named_format = has_named_fields(Str.sv());
+        /// Parsed format string for the arguments: the names of the arguments only matter to the named fields,
+        /// so the other format strings are parsed once for all the argument types.
+        template <strlit::StringType Str, class... Args>
+        using ParsedFormatFor = std::conditional_t<is_named_format<Str>, ParsedFormat<Str, std::remove_cvref_t<Args>...>, ParsedFormat<Str>>;
+    }
+    /// Format string parsed at compile time into a `details::ParsedFormat`, once for all the argument types,
+    /// or for every argument types if it has named fields, which are then resolved to indices at compile time.
+    template <strlit::StringType Str>
+    struct Compiled {};
+    template <strlit::StringType Str>
+    inline constexpr Compiled<Str> compiled{};
+
+    namespace details {
+        template <class T>
+        struct IsCompiled : std::false_type {};
+        template <strlit::StringType Str>
+        struct IsCompiled<Compiled<Str>> : std::true_type {};
+        /// Runtime or compiled format string. String literals are taken as `format_string` instead.
+        template <class T>
+        concept IsFormatText = (std::convertible_to<const T&, std::string_view> && !std::is_array_v<T>)
+            || IsCompiled<T>::value || std::same_as<T, cached_format>;
+
+        /// Error in the format string for the arguments, or nullptr, computed once for every format string.
+        template <strlit::StringType Str, class... Args>
+        inline constexpr const char* compiled_error = check_format<Args...>(Str.sv());
+        /// Key of the compiled format string in the instrumentation statistics.
+        template <strlit::StringType Str>
+        inline constexpr uint64_t format_key_of = format_key(Str.sv());
+    }
+
+    namespace details {
+        /// Compiled format strings are checked against the arguments by `vformat_to`.
+        template <strlit::StringType Str, class... Names>
+        inline auto vformat(SinkRef sink, ParsedFormat<Str, Names...>, FormatArgs args) -> void {
+            using compiled_t = ParsedFormat<Str, Names...>;
+            for (const auto& token : compiled_t::tokens) {
+                auto token_text = compiled_t::token_text(token);
+                if (!token.is_arg()) {
+                    sink.append(token_text);
+                } else {
+                    args[token.id].format(sink, token_text, args);
+                }
+            }
+        }
+        template <strlit::StringType Str, IsSink Sink, class... Args>
+        constexpr auto vformat_to(Sink& sink, Compiled<Str>, const Args&... args) -> void {
+            if constexpr (compiled_error<Str, Args...> != nullptr) {
+                static_assert((report_format_error(compiled_error<Str, Args...>), false), "invalid format string for the arguments");
+            }
+            using compiled_t = ParsedFormatFor<Str, Args...>;
+            instrumented(sink, Str.sv(), format_key_of<Str>, [&](auto& out) {
+                if (!std::is_constant_evaluated() && !use_variadic_args) {
+                    auto store = make_format_args(args...);
+                    vformat(out, compiled_t{}, store);
+                } else {
+                    for (const auto& token : compiled_t::tokens) {
+                        auto token_text = compiled_t::token_text(token);
+                        if (!token.is_arg()) {
+                            out.append(token_text);
+                        } else {
+                            format_arg<false>(out, token.id, token_text, args...);
+                        }
+                    }
+                }
+            });
+        }
+    }
+
+    template <strlit::StringType Str, class... Args>
+    constexpr auto format_runtime(Compiled<Str> format_text, const Args&... args) -> std::string {
+        std::string result;
+        result.reserve(details::ParsedFormatFor<Str, Args...>::text_size);
+        details::vformat_to(result, format_text, args...);
         return result;
     }
 
+    namespace details {
+        /// Format string known at runtime, parsed once like the compiled ones: the texts of the tokens are packed
+        /// in a single string. The format strings with named fields are kept as is and parsed on every call.
+        struct RuntimeParsedFormat {
+            std::string source;
+            uint64_t key = 0;
+            std::string text;
+            std::vector<CompiledToken> tokens;
+            bool named = false;
+
+            /// Throws `format_error` if the format string is invalid.
+            explicit RuntimeParsedFormat(std::string_view format_text)
+                : source(format_text)
+                , key(format_key(format_text))
+                , named(has_named_fields(format_text))
+            {
+                if (named) {
+                    return;
+                }
+                parse_merged(source, [&](int64_t id, std::string_view token_text, bool merged) {
+                    if (merged) {
+                        tokens.back().size += token_text.size();
+                    } else {
+                        tokens.push_back(CompiledToken{id, text.size(), token_text.size()});
+                    }
+                    text.append(token_text);
+                });
+            }
+            auto token_text(const CompiledToken& token) const -> std::string_view {
+                return std::string_view(text).substr(token.offset, token.size);
+            }
+        };
+    }
+
+    /// Format string known at runtime, parsed once and shared by its copies. See `cfmt::format_cache`.
+    /// Formatting with it only runs the formatters, and throws `format_error` if an argument does not match its field.
+    class cached_format {
+    public:
+        /// Throws `format_error` if the format string is invalid.
+        explicit cached_format(std::string_view format_text)
+            : m_parsed(std::make_shared<const details::RuntimeParsedFormat>(format_text))
+        {}
+        explicit cached_format(std::shared_ptr<const details::RuntimeParsedFormat> parsed) noexcept
+            : m_parsed(std::move(parsed))
+        {}
+        auto str() const noexcept -> std::string_view {
+            return m_parsed->source;
+        }
+        auto parsed() const noexcept -> const details::RuntimeParsedFormat& {
+            return *m_parsed;
+        }
+    private:
+        std::shared_ptr<const details::RuntimeParsedFormat> m_parsed;
+    };
+
+    namespace details {
+        inline auto vformat(SinkRef sink, const RuntimeParsedFormat& parsed, FormatArgs args) -> void {
+            if (parsed.named) {
+                vformat(sink, parsed.source, args);
+                return;
+            }
+            for (const auto& token : parsed.tokens) {
+                auto token_text = parsed.token_text(token);
+                if (!token.is_arg()) {
+                    sink.append(token_text);
+                } else {
+                    format_unchecked_arg(sink, token.id, token_text, args);
+                }
+            }
+        }
+        template <IsSink Sink>
+        auto vformat_to(Sink& sink, const cached_format& format_text, const auto&... args) -> void {
+            instrumented(sink, format_text.str(), format_text.parsed().key, [&](auto& out) {
+                auto store = make_format_args(args...);
+                vformat(out, format_text.parsed(), {store, arg_names<std::remove_cvref_t<decltype(args)>...>});
+            });
+        }
+    }
+
+    /// Formats with a format string parsed once.
+    inline auto format_runtime(const cached_format& format_text, const auto&... args) -> std::string {
+        std::string result;
+        result.reserve(format_text.parsed().text.size());
+        details::vformat_to(result, format_text, args...);
+        return result;
+    }
+
+    /// Writes the formatted text to the output iterator and returns the iterator past the end.
+    template <std::output_iterator<char> OutputIt, details::IsFormatText FormatT>
+    constexpr auto format_to(OutputIt out, const FormatT& format_text, const auto&... args) -> OutputIt {
+        IteratorSink<OutputIt> sink{out};
+        details::vformat_to(sink, format_text, args...);
+        return sink.out;
+    }
+    template <std::output_iterator<char> OutputIt, class... Args>
+    constexpr auto format_to(OutputIt out, format_string<Args...> format_text, const Args&... args) -> OutputIt {
+        IteratorSink<OutputIt> sink{out};
+        details::vformat_to(sink, format_text, args...);
+        return sink.out;
+    }
+
+    /// Appends the formatted text to the sink, eg a `std::string` or a `cfmt::memory_buffer`.
+    template <IsSink Sink, details::IsFormatText FormatT>
+        requires (!std::output_iterator<Sink, char>)
+    constexpr auto format_to(Sink& sink, const FormatT& format_text, const auto&... args) -> void {
+        details::vformat_to(sink, format_text, args...);
+    }
+    template <IsSink Sink, class... Args>
+        requires (!std::output_iterator<Sink, char>)
+    constexpr auto format_to(Sink& sink, format_string<Args...> format_text, const Args&... args) -> void {
+        details::vformat_to(sink, format_text, args...);
+    }
+
+    template <class OutputIt>
+    struct format_to_n_result {
+        OutputIt out;
+        size_t size;
+    };
+    /// Writes at most `n` characters of the formatted text to the output iterator.
+    /// The returned size is the size of the whole formatted text.
+    template <std::output_iterator<char> OutputIt, details::IsFormatText FormatT>
+    constexpr auto format_to_n(OutputIt out, size_t n, const FormatT& format_text, const auto&... args) -> format_to_n_result<OutputIt> {
+        TruncatingSink<OutputIt> sink{out, n};
+        details::vformat_to(sink, format_text, args...);
+        return {sink.out, sink.size};
+    }
+    template <std::output_iterator<char> OutputIt, class... Args>
+    constexpr auto format_to_n(OutputIt out, size_t n, format_string<Args...> format_text, const Args&... args) -> format_to_n_result<OutputIt> {
+        TruncatingSink<OutputIt> sink{out, n};
+        details::vformat_to(sink, format_text, args...);
+        return {sink.out, sink.size};
+    }
+
+    /// Size of the formatted text, without writing it.
+    template <details::IsFormatText FormatT>
+    constexpr auto formatted_size(const FormatT& format_text, const auto&... args) -> size_t {
+        CountingSink sink;
+        details::vformat_to(sink, format_text, args...);
+        return sink.size;
+    }
+    template <class... Args>
+    constexpr auto formatted_size(format_string<Args...> format_text, const Args&... args) -> size_t {
+        CountingSink sink;
+        details::vformat_to(sink, format_text, args...);
+        return sink.size;
+    }
+
+    /// Formats at compile time into a string of the exact size of the formatted text.
+    template <strlit::StringType Str, auto... args>
+    constexpr auto format() {
+        constexpr auto size = formatted_size(compiled<Str>, args...);
+        strlit::String<size+1> res;
+        format_to(res.text, compiled<Str>, args...);
+        return res;
+    }
 
+    /// Formats into a string of fixed size `N`, the remaining characters are filled with '\0'.
+    /// Prefer `format<"...", args...>()` when the arguments are known at compile time.
     template <size_t N = 10000>
-    constexpr auto format(std::string_view format_text, auto... args) -> strlit::String<N>
+    constexpr auto format(std::string_view format_text, const auto&... args) -> strlit::String<N>
     {
         strlit::String<N> res;
-        auto formatted = format_runtime(format_text, args...);
-        auto res_it = res.text;
+        auto res_it = format_to_n(res.text, N-1, format_text, args...).out;
         auto res_end = res.text+N;
-        res_it = std::copy(formatted.begin(), formatted.end(), res_it);
         std::fill(res_it, res_end, '\0');
         return res;
     }
@@ -0,0 +1,109 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "format.h"
+
+namespace cfmt {
+    /// Concurrent cache of the format strings known at runtime, eg loaded from a configuration:
+    /// every format string is parsed once, on its first lookup.
+    /// The cache is split into shards. A lookup only takes the shared lock of its shard, the exclusive one
+    /// is taken to add a format string. It holds at most about `capacity` format strings, evicted with the CLOCK
+    /// policy: the format strings looked up since the last pass of the clock hand get a second chance.
+    /// The handles stay valid after the eviction of their format string.
+    class format_cache {
+    public:
+        explicit format_cache(size_t capacity = 1024, size_t shard_count = 16)
+            : m_shard_count(std::max<size_t>(shard_count, 1))
+            , m_shard_capacity(std::max<size_t>((capacity + m_shard_count - 1) / m_shard_count, 1))
+            , m_shards(std::make_unique<Shard[]>(m_shard_count))
+        {}
+
+        /// Handle on the parsed format string, parsed if it is not in the cache.
+        /// Throws `format_error` if the format string is invalid.
+        auto get(std::string_view format_text) -> cached_format {
+            auto& shard = m_shards[std::hash<std::string_view>{}(format_text) % m_shard_count];
+            {
+                std::shared_lock lock(shard.mutex);
+                if (auto it = shard.entries.find(format_text); it != shard.entries.end()) {
+                    // only written when it changes, so the readers do not keep writing the line of the entry.
+                    // The shared lock still writes the mutex of the shard: the lookups of a shard contend on its
+                    // line, and the handles of the hot format strings are better kept than looked up.
+                    if (!it->second.referenced.load(std::memory_order_relaxed)) {
+                        it->second.referenced.store(true, std::memory_order_relaxed);
+                    }
+                    return cached_format(it->second.parsed);
+                }
+            }
+            // parsed out of the lock, another thread may parse it at the same time
+            auto parsed = std::make_shared<const details::RuntimeParsedFormat>(format_text);
+            std::unique_lock lock(shard.mutex);
+            if (auto it = shard.entries.find(format_text); it != shard.entries.end()) {
+                return cached_format(it->second.parsed);
+            }
+            auto key = std::string_view(parsed->source);
+            if (shard.entries.size() < m_shard_capacity) {
+                shard.clock.push_back(key);
+            } else {
+                shard.clock[evict(shard)] = key;
+            }
+            shard.entries.try_emplace(key).first->second.parsed = parsed;
+            return cached_format(std::move(parsed));
+        }
+        /// Number of format strings in the cache.
+        auto size() const -> size_t {
+            size_t result = 0;
+            for (size_t i = 0; i < m_shard_count; ++i) {
+                std::shared_lock lock(m_shards[i].mutex);
+                result += m_shards[i].entries.size();
+            }
+            return result;
+        }
+        auto clear() -> void {
+            for (size_t i = 0; i < m_shard_count; ++i) {
+                std::unique_lock lock(m_shards[i].mutex);
+                m_shards[i].entries.clear();
+                m_shards[i].clock.clear();
+                m_shards[i].hand = 0;
+            }
+        }
+    private:
+        struct Entry {
+            std::shared_ptr<const details::RuntimeParsedFormat> parsed;
+            std::atomic<bool> referenced = false;
+        };
+        /// Shards are aligned on cache lines, so the readers of different shards do not share the line of their lock.
+        struct alignas(64) Shard {
+            mutable std::shared_mutex mutex;
+            /// keyed by the text of the parsed format strings
+            std::unordered_map<std::string_view, Entry> entries;
+            /// keys of the entries, in the order of the clock hand
+            std::vector<std::string_view> clock;
+            size_t hand = 0;
+        };
+
+        /// Removes the first entry from the clock hand not referenced since the last pass, and returns its slot.
+        static auto evict(Shard& shard) -> size_t {
+            while (true) {
+                auto slot = shard.hand;
+                shard.hand = (shard.hand + 1) % shard.clock.size();
+                auto it = shard.entries.find(shard.clock[slot]);
+                if (!it->second.referenced.exchange(false, std::memory_order_relaxed)) {
+                    shard.entries.erase(it);
+                    return slot;
+                }
+            }
+        }
+
+        size_t m_shard_count;
+        size_t m_shard_capacity;
+        std::unique_ptr<Shard[]> m_shards;
+    };
+}
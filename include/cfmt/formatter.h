@@ -1,23 +1,70 @@
 #pragma once
+#include <algorithm>
 #include <concepts>
+#include <limits>
 #include <optional>
+#include <stdexcept>
 #include <string_view>
 #include <string>
 #include <type_traits>
 #include "utils.h"
+#include "sink.h"
+#include "digits.h"
+#include "dtoa.h"
+#include "unicode.h"
+#include "locale.h"
+#include "instrument.h"
 
 namespace cfmt 
 {
-    //format_spec ::= [[fill]align][sign]["#"]["0"][width]["." precision]["L"][type]
+    /// Error in a format string known at runtime. Format strings known at compile time fail the build instead.
+    class format_error : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+    namespace details {
+        struct ThrowErrors {
+            auto operator()(const char* message) const -> void {
+                throw format_error(message);
+            }
+        };
+        namespace format_errors {
+            /// Not constexpr, so the constant evaluations formatting with 'L' fail the build, with its name in the diagnostic.
+            inline auto localized_option_evaluated_at_compile_time() -> void {}
+        }
+        /// Value of the integer argument giving a width or a precision, which must fit in an `int64_t`.
+        template <std::integral T>
+        constexpr auto checked_integer(T value) -> int64_t {
+            if constexpr (std::unsigned_integral<T> && sizeof(T) >= sizeof(int64_t)) {
+                if (value > static_cast<T>(std::numeric_limits<int64_t>::max())) {
+                    ThrowErrors{}("number is too big");
+                }
+            }
+            return static_cast<int64_t>(value);
+        }
+    }
+
+    //format_spec ::= [[fill]align][sign]["#"]["0"][width]["." precision]["L"][type][range_spec]
+    //range_spec ::= "|" separator "|" ["n" | open close]
     struct FormatDescriptor {
         std::optional<std::pair<char, char>> fill_align;
         char sign = '-';
         bool numb_prefix = false;
         bool zero_pad = false;
         uint32_t width = 0;
-        uint32_t precision = 0;
+        std::optional<uint32_t> precision;
+        /// index of the argument giving the width, eg "{:{1}}"
+        std::optional<int64_t> width_arg;
+        /// index of the argument giving the precision, eg "{:.{1}}"
+        std::optional<int64_t> precision_arg;
+        /// Largest precision, the one the exact digits of the floating point numbers support
+        static constexpr uint32_t max_precision = details::ExactDecimal::max_precision;
         bool localized = false;
         std::optional<char> type;
+        /// separator of the items of containers, eg "{:|; |}"
+        std::optional<std::string_view> separator;
+        /// opening and closing characters of containers, empty for none, eg "{:|, |[]}" or "{:|, |n}"
+        std::optional<std::string_view> brackets;
 
         template <class It>
         constexpr auto parse_fill_align(It begin, It end) noexcept {
@@ -75,11 +122,32 @@ namespace cfmt
             }
             return begin;
         }
+        /// Parses a nested field "{N}" and returns the position after it, or `begin` if there is none.
+        template <class It>
+        constexpr auto parse_arg_id(It begin, It end, std::optional<int64_t>& id) noexcept {
+            if (begin == end || *begin != '{') {
+                return begin;
+            }
+            auto it = std::next(begin);
+            int64_t value = 0;
+            while (it != end && *it >= '0' && *it <= '9') {
+                value = value*10 + (*it - '0');
+                ++it;
+            }
+            if (it == end || *it != '}') {
+                return begin;
+            }
+            id = value;
+            return ++it;
+        }
         template <class It>
         constexpr auto parse_width(It begin, It end) noexcept {
             if (begin == end) {
                 return begin;
             }
+            if (auto it = parse_arg_id(begin, end, width_arg); it != begin) {
+                return it;
+            }
             while (begin != end && *begin >= '0' && *begin <= '9') {
                 width = width*10 + (*begin - '0');
                 ++begin;
@@ -88,17 +156,20 @@ namespace cfmt
         }
         template <class It>
         constexpr auto parse_precision(It begin, It end) noexcept {
-            /// TODO: implement float precision
-            // if (begin == end) {
-            //     return begin;
-            // }
-            // if (*begin == '.') {
-            //     ++begin;
-            //     while (begin != end && *begin >= '0' && *begin <= '9') {
-            //         precision = precision*10 + (*begin - '0');
-            //         ++begin;
-            //     }
-            // }
+            if (begin == end || *begin != '.') {
+                return begin;
+            }
+            ++begin;
+            if (auto it = parse_arg_id(begin, end, precision_arg); it != begin) {
+                return it;
+            }
+            // saturates above `max_precision` instead of wrapping, so that the check of the spec rejects it
+            uint64_t value = 0;
+            while (begin != end && *begin >= '0' && *begin <= '9') {
+                value = std::min<uint64_t>(value*10 + (*begin - '0'), uint64_t(max_precision) + 1);
+                ++begin;
+            }
+            precision = static_cast<uint32_t>(value);
             return begin;
         }
         template <class It>
@@ -125,14 +196,14 @@ namespace cfmt
                 case 'o': // octal
                 case 'x': // hex lower
                 case 'X': // hex upper
-                // case 'a':
-                // case 'A':
-                // case 'e':
-                // case 'E':
-                // case 'f':
-                // case 'F':
-                // case 'g':
-                // case 'G':
+                case 'a': // hex float lower
+                case 'A': // hex float upper
+                case 'e': // scientific lower
+                case 'E': // scientific upper
+                case 'f': // fixed lower
+                case 'F': // fixed upper
+                case 'g': // general lower
+                case 'G': // general upper
                 case 'p': // pointer
                 case 's': // string
                     type = *begin;
@@ -141,6 +212,28 @@ namespace cfmt
             return begin;
         }
         template <class It>
+        constexpr auto parse_range(It begin, It end) noexcept {
+            if (begin == end || *begin != '|') {
+                return begin;
+            }
+            auto separator_begin = std::next(begin);
+            auto separator_end = std::find(separator_begin, end, '|');
+            if (separator_end == end) {
+                return begin;
+            }
+            separator = std::string_view(separator_begin, separator_end);
+            auto it = std::next(separator_end);
+            if (it != end && *it == 'n') {
+                brackets = std::string_view{};
+                return ++it;
+            }
+            if (std::distance(it, end) >= 2) {
+                brackets = std::string_view(it, std::next(it, 2));
+                return std::next(it, 2);
+            }
+            return it;
+        }
+        template <class It>
         constexpr auto parse(It begin, It end) noexcept {
             begin = parse_fill_align(begin, end);
             begin = parse_sign(begin, end);
@@ -150,6 +243,7 @@ namespace cfmt
             begin = parse_precision(begin, end);
             begin = parse_localized(begin, end);
             begin = parse_type(begin, end);
+            begin = parse_range(begin, end);
             return begin;
         }
     };
@@ -158,34 +252,52 @@ namespace cfmt
 
     template <>
     struct Formatter<std::string_view> {
+        /// Presentation types accepted by the formatter, checked with the format strings known at compile time.
+        static constexpr std::string_view presentation_types = "s";
+
         constexpr auto parse(std::string_view input) const -> FormatDescriptor {
             FormatDescriptor desc;
             desc.parse(input.begin(), input.end());
             return desc;
         }
+        template <class DescriptorType, IsSink Sink>
+        constexpr auto format(const std::string_view& input, const DescriptorType& desc, Sink& sink) const -> void {
+            if (desc.width == 0) {
+                sink.append(input);
+                return;
+            }
+            format_padded(details::display_width(input), desc, sink, [input](auto& out) {
+                out.append(input);
+            });
+        }
+        /// Exact size of the formatted value, used to reserve the output and to pad without formatting twice.
+        template <class DescriptorType>
+        constexpr auto size_hint(const std::string_view& input, const DescriptorType& desc) const -> size_t {
+            if (desc.width == 0) {
+                return input.length();
+            }
+            auto width = details::display_width(input);
+            return input.length() + (width < desc.width ? desc.width - width : 0);
+        }
+        /// Writes the fill characters around the text written by `write`, which is `width` columns wide.
+        template <class DescriptorType, IsSink Sink, class WriteFn>
+        constexpr auto format_padded(size_t width, const DescriptorType& desc, Sink& sink, WriteFn&& write) const -> void {
+            if (width >= desc.width) {
+                write(sink);
+                return;
+            }
+            auto [fill, align] = desc.fill_align.value_or(std::make_pair(' ', '<'));
+            auto padding = desc.width-width;
+            auto left = align == '>' ? padding : (align == '^' ? padding/2 : 0);
+            sink.append(left, fill);
+            write(sink);
+            sink.append(padding-left, fill);
+        }
         template <class DescriptorType>
         constexpr auto format(const std::string_view& input, const DescriptorType& desc) const -> std::string{
-            auto str = std::string_view(input);
             std::string result;
-            result.reserve(std::max<size_t>(str.length(),desc.width));
-            if (str.length() >= desc.width) {
-                result.append(str);
-            } else {
-                auto [fill, align] = desc.fill_align.value_or(std::make_pair(' ', '<'));
-                if (align == '<') {
-                    result.append(str);
-                    result.append(desc.width-str.length(), fill);
-                } else if (align == '>') {
-                    result.append(desc.width-str.length(), fill);
-                    result.append(str);
-                } else if (align == '^') {
-                    auto left = std::max<int32_t>(0,desc.width-str.length())/2;
-                    auto right = desc.width-str.length()-left;
-                    result.append(left, fill);
-                    result.append(str);
-                    result.append(right, fill);
-                }
-            }
+            result.reserve(size_hint(input, desc));
+            format(input, desc, result);
             return result;
         }
     };
@@ -193,71 +305,411 @@ namespace cfmt
     template <class StringT>
         requires std::convertible_to<StringT, std::string_view>
     struct Formatter<StringT> : Formatter<std::string_view> {
+        template <class DescriptorType, IsSink Sink>
+        constexpr auto format(const StringT& input, const DescriptorType& desc, Sink& sink) const -> void {
+            Formatter<std::string_view>::format(std::string_view(input), desc, sink);
+        }
         template <class DescriptorType>
         constexpr auto format(const StringT& input, const DescriptorType& desc) const -> std::string{
             return Formatter<std::string_view>::format(std::string_view(input), desc);
         }
+        template <class DescriptorType>
+        constexpr auto size_hint(const StringT& input, const DescriptorType& desc) const -> size_t {
+            return Formatter<std::string_view>::size_hint(std::string_view(input), desc);
+        }
     };
 
     template <std::integral IntegralT>
     struct Formatter<IntegralT> : Formatter<std::string_view>
     {
+        /// sign + prefix + binary digits of the largest integer
+        static constexpr size_t buffer_size = 1 + 2 + sizeof(IntegralT)*8;
+        static constexpr std::string_view presentation_types = "bBdoxX";
+
+        template <class DescriptorType, IsSink Sink>
+        constexpr auto format(IntegralT input, const DescriptorType& desc, Sink& sink) const -> void {
+            char buffer[buffer_size];
+            auto digits = prefix_to_chars(buffer, input, desc);
+            auto end = int_to_chars(digits, input, desc);
+            auto size = static_cast<size_t>(end - buffer);
+            if (desc.zero_pad && !desc.fill_align && size < desc.width) {
+                // zeros are inserted between the sign/prefix and the digits
+                sink.append(std::string_view(buffer, digits));
+                sink.append(desc.width - size, '0');
+                sink.append(std::string_view(digits, end));
+            } else {
+                Formatter<std::string_view>::format(std::string_view(buffer, end), desc, sink);
+            }
+        }
         template <class DescriptorType>
         constexpr auto format(IntegralT input, const DescriptorType& desc) const -> std::string {
-            return Formatter<std::string_view>::format(int_to_string(input, desc), desc);
+            std::string result;
+            format(input, desc, result);
+            return result;
         }
         template <class DescriptorType>
-        constexpr auto int_to_string(std::integral auto input, const DescriptorType& params) const -> std::string {
-            constexpr char digits[] = "0123456789abcdef";
-            std::string result;
-            result.reserve(sizeof(IntegralT)*8 + 2 + (params.sign ? 1 : 0));
-            auto base = 10;
-            auto is_upper = false;
-            switch (params.type.value_or('d')) {
-                case 'b': base = 2; break;
-                case 'B': base = 2; is_upper = true; break;
-                case 'o': base = 8; break;
-                case 'x': base = 16; break;
-                case 'X': base = 16; is_upper = true; break;
-                case 'd': base = 10; break;
-                default: break;
-            }
-            auto to_upper = is_upper 
-                ? [](char ch) { return utils::to_upper(ch); } 
-                : [](char ch) { return ch; };
-            if (std::signed_integral<decltype(input)> && input < 0) {
-                result.push_back('-');
-                input = -input;
+        constexpr auto size_hint(IntegralT input, const DescriptorType& desc) const -> size_t {
+            char prefix[3];
+            auto size = static_cast<size_t>(prefix_to_chars(prefix, input, desc) - prefix);
+            auto value = details::magnitude(input);
+            switch (desc.type.value_or('d')) {
+                case 'b':
+                case 'B': size += details::count_digits(value, 1); break;
+                case 'o': size += details::count_digits(value, 3); break;
+                case 'x':
+                case 'X': size += details::count_digits(value, 4); break;
+                default:
+                    size += details::count_digits(value);
+                    if (desc.localized) {
+                        size += grouping(desc).separator_count(details::count_digits(value));
+                    }
+                    break;
+            }
+            return std::max<size_t>(size, desc.width);
+        }
+        /// Writes the sign and the base prefix at `begin` and returns the end of the prefix.
+        template <class DescriptorType>
+        constexpr auto prefix_to_chars(char* begin, IntegralT input, const DescriptorType& params) const -> char* {
+            auto is_negative = false;
+            if constexpr (std::signed_integral<IntegralT>) {
+                is_negative = input < 0;
+            }
+            if (is_negative) {
+                *begin++ = '-';
             } else if (params.sign == '+') {
-                result.push_back('+');
+                *begin++ = '+';
             } else if (params.sign == ' ') {
-                result.push_back(' ');
+                *begin++ = ' ';
             }
-
             if (params.numb_prefix) {
-                if (base == 16) {
-                    result.push_back('0');
-                    result.push_back(to_upper('x'));
-                } else if (base == 8) {
-                    result.push_back('0');
-                } else if (base == 2) {
-                    result.push_back('0');
-                    result.push_back(to_upper('b'));
+                switch (params.type.value_or('d')) {
+                    case 'b': *begin++ = '0'; *begin++ = 'b'; break;
+                    case 'B': *begin++ = '0'; *begin++ = 'B'; break;
+                    case 'o':
+                        // the leading zero of 0 is its prefix, like printf "%#o"
+                        if (input != 0) {
+                            *begin++ = '0';
+                        }
+                        break;
+                    case 'x': *begin++ = '0'; *begin++ = 'x'; break;
+                    case 'X': *begin++ = '0'; *begin++ = 'X'; break;
+                    default: break;
+                }
+            }
+            return begin;
+        }
+        /// Writes the digits of the absolute value at `begin` and returns the end of the digits.
+        template <class DescriptorType>
+        constexpr auto int_to_chars(char* begin, IntegralT input, const DescriptorType& params) const -> char* {
+            auto value = details::magnitude(input);
+            switch (params.type.value_or('d')) {
+                case 'b': 
+                case 'B': return details::write_power_of_2(begin, value, 1, false);
+                case 'o': return details::write_power_of_2(begin, value, 3, false);
+                case 'x': return details::write_power_of_2(begin, value, 4, false);
+                case 'X': return details::write_power_of_2(begin, value, 4, true);
+                default:
+                    if (params.localized) {
+                        if (const auto& digit_grouping = grouping(params); digit_grouping.is_grouped()) {
+                            return details::write_decimal_grouped(begin, value, digit_grouping);
+                        }
+                    }
+                    return details::write_decimal(begin, value);
+            }
+        }
+    private:
+        /// Grouping of the decimal digits with 'L'. It is only known at runtime, so 'L' fails
+        /// the constant evaluations instead of giving other digits than at runtime.
+        template <class DescriptorType>
+        static constexpr auto grouping(const DescriptorType& desc) -> const DigitGrouping& {
+            if (std::is_constant_evaluated()) {
+                if (desc.localized) {
+                    details::format_errors::localized_option_evaluated_at_compile_time();
                 }
+                return ungrouped;
             }
-            if (input == 0) {
-                result.push_back('0');
+            return digit_grouping();
+        }
+        static constexpr DigitGrouping ungrouped = {};
+    };
+
+    template <std::floating_point FloatT>
+    struct Formatter<FloatT> : Formatter<std::string_view>
+    {
+        static constexpr std::string_view presentation_types = "aAeEfFgG";
+        template <class DescriptorType, IsSink Sink>
+        constexpr auto format(FloatT input, const DescriptorType& desc, Sink& sink) const -> void {
+            if constexpr (sizeof(FloatT) > sizeof(double)) {
+                Formatter<double>{}.format(static_cast<double>(input), desc, sink);
             } else {
-                auto begin = result.end();
-                while (input > 0) {
-                    result.push_back(to_upper(digits[input % base]));
-                    input /= base;
+                auto decoded = details::DecodedFloat<FloatT>(input);
+                char sign[1];
+                auto sign_end = sign;
+                if (decoded.negative) {
+                    *sign_end++ = '-';
+                } else if (desc.sign == '+' || desc.sign == ' ') {
+                    *sign_end++ = desc.sign;
+                }
+                auto write = [&](auto& out) {
+                    float_to_sink(decoded, input, desc, out);
+                };
+                if (desc.width == 0) {
+                    sink.append(std::string_view(sign, sign_end));
+                    write(sink);
+                    return;
+                }
+                CountingSink counter;
+                write(counter);
+                auto size = static_cast<size_t>(sign_end - sign) + counter.size;
+                if (desc.zero_pad && !desc.fill_align && decoded.is_finite() && size < desc.width) {
+                    sink.append(std::string_view(sign, sign_end));
+                    sink.append(desc.width - size, '0');
+                    write(sink);
+                } else {
+                    format_padded(size, desc, sink, [&](auto& out) {
+                        out.append(std::string_view(sign, sign_end));
+                        write(out);
+                    });
                 }
-                std::reverse(begin, result.end());
             }
+        }
+        template <class DescriptorType>
+        constexpr auto format(FloatT input, const DescriptorType& desc) const -> std::string {
+            std::string result;
+            format(input, desc, result);
             return result;
         }
+        /// Writes the absolute value.
+        template <class DescriptorType, IsSink Sink>
+        constexpr auto float_to_sink(const details::DecodedFloat<FloatT>& decoded, FloatT input, const DescriptorType& desc, Sink& sink) const -> void {
+            auto type = desc.type.value_or('\0');
+            auto upper = type == 'E' || type == 'F' || type == 'G' || type == 'A';
+            if (!decoded.is_finite()) {
+                sink.append(decoded.is_nan() ? (upper ? "NAN" : "nan") : (upper ? "INF" : "inf"));
+                return;
+            }
+            if (type == 'a' || type == 'A') {
+                details::write_hex(sink, decoded, desc.precision, desc.numb_prefix, upper);
+                return;
+            }
+            auto point = desc.numb_prefix;
+            char digits[details::ExactDecimal::capacity];
+            if (type == 'e' || type == 'E') {
+                auto precision = desc.precision.value_or(6);
+                auto exact = to_exact(digits, decoded, static_cast<int32_t>(precision) + 1, false);
+                details::write_exponent(sink, std::string_view(digits, exact.count), exact.exponent, precision, point, upper);
+            } else if (type == 'f' || type == 'F') {
+                auto precision = desc.precision.value_or(6);
+                auto exact = to_exact(digits, decoded, static_cast<int32_t>(precision), true);
+                details::write_fixed(sink, std::string_view(digits, exact.count), exact.exponent, precision, point);
+            } else if (type == 'g' || type == 'G' || desc.precision) {
+                auto precision = std::max<int32_t>(1, static_cast<int32_t>(desc.precision.value_or(6)));
+                auto exact = to_exact(digits, decoded, precision, false);
+                auto count = exact.count;
+                if (!point) {
+                    while (count > 0 && digits[count-1] == '0') {
+                        --count;
+                    }
+                }
+                auto digits_sv = std::string_view(digits, count);
+                auto exponent = exact.count == 0 ? 0 : exact.exponent;
+                if (exponent >= -4 && exponent < precision) {
+                    auto fraction = point ? precision - 1 - exponent : std::max<int32_t>(0, static_cast<int32_t>(count) - 1 - exponent);
+                    details::write_fixed(sink, digits_sv, exponent, static_cast<size_t>(fraction), point);
+                } else {
+                    auto fraction = point ? precision - 1 : std::max<int32_t>(0, static_cast<int32_t>(count) - 1);
+                    details::write_exponent(sink, digits_sv, exponent, static_cast<size_t>(fraction), point, upper);
+                }
+            } else {
+                // shortest round-trip representation
+                if (decoded.is_zero()) {
+                    details::write_fixed(sink, {}, 0, 0, point);
+                    return;
+                }
+                auto shortest = details::to_shortest(input < 0 ? -input : input);
+                auto end = details::write_decimal(digits, shortest.significand);
+                auto count = static_cast<int32_t>(end - digits);
+                auto exponent = shortest.exponent + count - 1;
+                auto digits_sv = std::string_view(digits, end);
+                if (exponent < -4 || exponent >= 16) {
+                    details::write_exponent(sink, digits_sv, exponent, static_cast<size_t>(count - 1), point, false);
+                } else {
+                    details::write_fixed(sink, digits_sv, exponent, static_cast<size_t>(std::max(0, count - 1 - exponent)), point);
+                }
+            }
+        }
+    private:
+        static constexpr auto to_exact(char* digits, const details::DecodedFloat<FloatT>& decoded, int32_t precision, bool fixed) -> details::ExactDecimal {
+            if (decoded.is_zero()) {
+                return {0, 0};
+            }
+            return details::to_exact(digits, decoded.mantissa(), decoded.binary_exponent(), precision, fixed);
+        }
     };
+
+    namespace details {
+        /// Uses the sink overload of the formatter if any, else appends the returned string.
+        template <class FormatterT, class T, class DescriptorType, IsSink Sink>
+        constexpr auto format_to_sink(const FormatterT& formatter, const T& value, const DescriptorType& desc, Sink& sink) -> void {
+            if constexpr (requires { formatter.format(value, desc, sink); }) {
+                formatter.format(value, desc, sink);
+            } else {
+                sink.append(formatter.format(value, desc));
+            }
+        }
+        template <class FormatterT, class T, class DescriptorType>
+        concept HasSizeHint = requires(const FormatterT& formatter, const T& value, const DescriptorType& desc) {
+            { formatter.size_hint(value, desc) } -> std::convertible_to<size_t>;
+        };
+        /// Exact size of the formatted value: the size hint of the formatter if any, else the size counted by formatting it.
+        template <class FormatterT, class T, class DescriptorType>
+        constexpr auto formatted_size_of(const FormatterT& formatter, const T& value, const DescriptorType& desc) -> size_t {
+            if constexpr (HasSizeHint<FormatterT, T, DescriptorType>) {
+                return formatter.size_hint(value, desc);
+            } else {
+                CountingSink counter;
+                format_to_sink(formatter, value, desc, counter);
+                return counter.size;
+            }
+        }
+        /// Display width of the formatted value. The digits of the numbers are one column each, so their width is
+        /// their size hint; other values are formatted to count their width.
+        template <class FormatterT, class T, class DescriptorType>
+        constexpr auto formatted_width_of(const FormatterT& formatter, const T& value, const DescriptorType& desc) -> size_t {
+            if constexpr (std::is_arithmetic_v<T> && HasSizeHint<FormatterT, T, DescriptorType>) {
+                return formatter.size_hint(value, desc);
+            } else {
+                WidthCountingSink counter;
+                format_to_sink(formatter, value, desc, counter);
+                return counter.width;
+            }
+        }
+        /// Separator and brackets of the items of containers.
+        template <class DescriptorType>
+        constexpr auto range_separator(const DescriptorType& desc) -> std::string_view {
+            if constexpr (requires { desc.separator; }) {
+                return desc.separator.value_or(", ");
+            } else {
+                return ", ";
+            }
+        }
+        template <class DescriptorType>
+        constexpr auto range_brackets(const DescriptorType& desc) -> std::string_view {
+            if constexpr (requires { desc.brackets; }) {
+                return desc.brackets.value_or("{}");
+            } else {
+                return "{}";
+            }
+        }
+        /// The items of ranges and maps are formatted with the descriptor of the range, without its padding.
+        template <class DescriptorType>
+        constexpr auto range_items_descriptor(const DescriptorType& desc) -> DescriptorType {
+            auto item_desc = desc;
+            item_desc.fill_align = std::nullopt;
+            item_desc.width = 0;
+            return item_desc;
+        }
+        /// Width or precision given by an argument: negative values are taken as 0, and values
+        /// beyond `uint32_t` throw `format_error` instead of wrapping.
+        constexpr auto dynamic_size(int64_t value) -> uint32_t {
+            if (value > static_cast<int64_t>(std::numeric_limits<uint32_t>::max())) {
+                ThrowErrors{}("number is too big");
+            }
+            return static_cast<uint32_t>(std::max<int64_t>(0, value));
+        }
+        /// Sets the width and the precision given by other arguments.
+        /// `get_integer` returns the integer value of the argument at the given index.
+        template <class DescriptorType, class GetIntegerFn>
+        constexpr auto resolve_dynamic(DescriptorType& desc, GetIntegerFn&& get_integer) -> void {
+            if constexpr (requires { desc.width_arg; desc.precision_arg; }) {
+                if (desc.width_arg) {
+                    desc.width = dynamic_size(get_integer(*desc.width_arg));
+                }
+                if (desc.precision_arg) {
+                    desc.precision = dynamic_size(get_integer(*desc.precision_arg));
+                    if (*desc.precision > FormatDescriptor::max_precision) {
+                        ThrowErrors{}("precision is too big");
+                    }
+                }
+            }
+        }
+        /// True if the formatter parses its spec with the built-in `FormatDescriptor`.
+        template <class FormatterT>
+        concept HasBuiltinParse = requires {
+            requires std::same_as<decltype(&FormatterT::parse), decltype(&Formatter<std::string_view>::parse)>;
+        };
+        /// Presentation types accepted by the formatter, or nullopt if it does not declare them,
+        /// in which case the type of its specs is not checked.
+        template <class FormatterT>
+        constexpr auto presentation_types_of() -> std::optional<std::string_view> {
+            if constexpr (requires { std::optional<std::string_view>(FormatterT::presentation_types); }) {
+                return FormatterT::presentation_types;
+            } else {
+                return std::nullopt;
+            }
+        }
+        /// Parses the spec into `desc` and checks it against the presentation types of the formatter.
+        template <class FormatterT>
+        constexpr auto check_builtin_spec(FormatDescriptor& desc, std::string_view spec) -> const char* {
+            if (desc.parse(spec.begin(), spec.end()) != spec.end()) {
+                return "invalid format spec";
+            }
+            if (desc.precision > FormatDescriptor::max_precision) {
+                return "precision is too big";
+            }
+            auto types = presentation_types_of<FormatterT>();
+            if (desc.type && types && types->find(*desc.type) == std::string_view::npos) {
+                return "invalid presentation type for the argument";
+            }
+            return nullptr;
+        }
+        /// Checks the spec of a field against the formatter of its argument.
+        /// Formatters with their own parse can check their spec with `static constexpr auto check_spec(std::string_view) -> const char*`.
+        /// Returns the error message, or nullptr if the spec is valid.
+        template <class T>
+        constexpr auto check_spec(std::string_view spec) -> const char* {
+            using FormatterT = Formatter<std::remove_cvref_t<T>>;
+            if constexpr (requires { FormatterT::check_spec(spec); }) {
+                return FormatterT::check_spec(spec);
+            } else if constexpr (HasBuiltinParse<FormatterT>) {
+                FormatDescriptor desc;
+                return check_builtin_spec<FormatterT>(desc, spec);
+            } else {
+                return nullptr;
+            }
+        }
+        /// Parses the spec of a field with the formatter of its argument. With `CheckSpec`, an invalid spec
+        /// throws `format_error`: the built-in descriptor is checked on the same parse, the formatters with
+        /// their own parse are checked with their `check_spec` first, unless they declare
+        /// `static constexpr bool parse_checks_spec = true` because their parse throws on invalid specs.
+        template <bool CheckSpec, class T>
+        constexpr auto parse_spec(const Formatter<T>& formatter, std::string_view spec) {
+            using FormatterT = Formatter<T>;
+            if constexpr (CheckSpec && HasBuiltinParse<FormatterT> && !requires { FormatterT::check_spec(spec); }) {
+                FormatDescriptor desc;
+                if (auto error = check_builtin_spec<FormatterT>(desc, spec)) {
+                    ThrowErrors{}(error);
+                }
+                return desc;
+            } else {
+                if constexpr (CheckSpec && !requires { requires FormatterT::parse_checks_spec; }) {
+                    if (auto error = check_spec<T>(spec)) {
+                        ThrowErrors{}(error);
+                    }
+                }
+                return formatter.parse(spec);
+            }
+        }
+        /// Formats the value of a field with its spec, checked with `CheckSpec` (see `parse_spec`).
+        template <bool CheckSpec = false, class T, IsSink Sink, class GetIntegerFn>
+        constexpr auto format_value(Sink& sink, const T& value, std::string_view format, GetIntegerFn&& get_integer) -> void {
+            instrument_field();
+            auto formatter = Formatter<T>{};
+            auto descriptor = parse_spec<CheckSpec>(formatter, format);
+            resolve_dynamic(descriptor, get_integer);
+            format_to_sink(formatter, value, descriptor, sink);
+        }
+    }
     template <class T>
     concept IsFormatter = requires(T t, std::string_view input, FormatDescriptor desc) {
         t.parse(input);
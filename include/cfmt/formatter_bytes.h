@@ -0,0 +1,334 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ranges>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include "formatter.h"
+#include "details/simd.h"
+
+namespace cfmt {
+    namespace details {
+        template <class T>
+        concept IsByte = std::same_as<T, std::byte> || std::same_as<T, unsigned char>
+            || std::same_as<T, char> || std::same_as<T, signed char>;
+
+        template <IsByte T>
+        constexpr auto byte_value(T value) -> uint8_t {
+            return static_cast<uint8_t>(value);
+        }
+
+        /// "00", "01", ..., "ff" packed together
+        inline constexpr auto hex_pairs = [] {
+            std::array<std::array<char, 512>, 2> result{};
+            for (size_t i = 0; i < 256; ++i) {
+                result[0][i*2] = digits_lower[i >> 4];
+                result[0][i*2+1] = digits_lower[i & 0xf];
+                result[1][i*2] = digits_upper[i >> 4];
+                result[1][i*2+1] = digits_upper[i & 0xf];
+            }
+            return result;
+        }();
+
+        /// Writes two hex digits per byte at `out` and returns the end.
+        /// At runtime, 16 bytes are converted at a time with SSE2 or NEON.
+        template <IsByte T>
+        constexpr auto write_hex_bytes(char* out, const T* data, size_t size, bool upper) -> char* {
+            size_t i = 0;
+            if (!std::is_constant_evaluated()) {
+                auto bytes = reinterpret_cast<const unsigned char*>(data);
+#if defined(CFMT_SSE2)
+                const auto nibble_mask = _mm_set1_epi8(0x0f);
+                const auto nine = _mm_set1_epi8(9);
+                const auto zero = _mm_set1_epi8('0');
+                const auto letter_offset = _mm_set1_epi8(static_cast<char>((upper ? 'A' : 'a') - '0' - 10));
+                auto to_ascii = [&](__m128i nibbles) {
+                    auto letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, nine), letter_offset);
+                    return _mm_add_epi8(_mm_add_epi8(nibbles, zero), letters);
+                };
+                for (; size - i >= 16; i += 16) {
+                    auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+                    auto high = _mm_and_si128(_mm_srli_epi16(chunk, 4), nibble_mask);
+                    auto low = _mm_and_si128(chunk, nibble_mask);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), to_ascii(_mm_unpacklo_epi8(high, low)));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), to_ascii(_mm_unpackhi_epi8(high, low)));
+                    out += 32;
+                }
+#elif defined(CFMT_NEON)
+                const auto table = vld1q_u8(reinterpret_cast<const uint8_t*>(upper ? digits_upper : digits_lower));
+                for (; size - i >= 16; i += 16) {
+                    auto chunk = vld1q_u8(bytes + i);
+                    uint8x16x2_t digits;
+                    digits.val[0] = vqtbl1q_u8(table, vshrq_n_u8(chunk, 4));
+                    digits.val[1] = vqtbl1q_u8(table, vandq_u8(chunk, vdupq_n_u8(0x0f)));
+                    vst2q_u8(reinterpret_cast<uint8_t*>(out), digits);
+                    out += 32;
+                }
+#endif
+            }
+            const auto& pairs = hex_pairs[upper];
+            for (; i < size; ++i) {
+                out = std::copy_n(pairs.data() + static_cast<size_t>(byte_value(data[i])) * 2, 2, out);
+            }
+            return out;
+        }
+        /// Writes eight binary digits per byte at `out` and returns the end.
+        /// At runtime, the bits of a byte are spread to the eight digits with a multiplication.
+        template <IsByte T>
+        constexpr auto write_binary_bytes(char* out, const T* data, size_t size) -> char* {
+            if (!std::is_constant_evaluated() && std::endian::native == std::endian::little) {
+                for (size_t i = 0; i < size; ++i) {
+                    // byte k of the product holds the byte, masked to keep its bit 7-k
+                    auto bits = (byte_value(data[i]) * 0x0101010101010101ull) & 0x0102040810204080ull;
+                    auto digits = (((bits + 0x7f7f7f7f7f7f7f7full) >> 7) & 0x0101010101010101ull) + 0x3030303030303030ull;
+                    std::memcpy(out, &digits, 8);
+                    out += 8;
+                }
+                return out;
+            }
+            for (size_t i = 0; i < size; ++i) {
+                auto value = byte_value(data[i]);
+                for (int bit = 7; bit >= 0; --bit) {
+                    *out++ = static_cast<char>('0' + ((value >> bit) & 1));
+                }
+            }
+            return out;
+        }
+
+        /// Writes a dump of the bytes: hex ('x', 'X') or binary ('b') digits, in groups of `precision` bytes
+        /// separated by the range separator (" " by default). The '#' flag writes lines of 16 bytes preceded by their offset.
+        template <IsByte T>
+        struct ByteDump {
+            static constexpr size_t line_size = 16;
+
+            const T* data;
+            size_t size;
+            char type = 'x';
+            size_t group = 0;
+            bool lines = false;
+            std::string_view separator = " ";
+            /// Hex digits of the offsets of the lines: 8, or more for the offsets beyond 4 GiB
+            size_t offset_digits = 8;
+
+            template <class DescriptorType>
+            constexpr ByteDump(const T* data, size_t size, const DescriptorType& desc)
+                : data(data)
+                , size(size)
+                , type(desc.type.value_or('x'))
+                , group(desc.precision.value_or(0))
+                , lines(desc.numb_prefix)
+            {
+                if constexpr (requires { desc.separator; }) {
+                    separator = desc.separator.value_or(" ");
+                }
+                if (lines && size > line_size) {
+                    auto last_offset = static_cast<uint64_t>((size - 1) / line_size * line_size);
+                    offset_digits = std::max<size_t>(offset_digits, count_digits(last_offset, 4));
+                }
+            }
+            /// Size of the offset of a line, eg "0000abcd: "
+            constexpr auto offset_size() const -> size_t {
+                return offset_digits + 2;
+            }
+            constexpr auto digits_per_byte() const -> size_t {
+                return type == 'b' || type == 'B' ? 8 : 2;
+            }
+            /// Size of the dump of `count` bytes of a line.
+            constexpr auto chunk_size(size_t count) const -> size_t {
+                auto result = count * digits_per_byte();
+                if (group != 0 && count > group) {
+                    result += ((count + group - 1) / group - 1) * separator.size();
+                }
+                return result;
+            }
+            constexpr auto formatted_size() const -> size_t {
+                if (!lines) {
+                    return chunk_size(size);
+                }
+                if (size == 0) {
+                    return 0;
+                }
+                auto line_count = (size + line_size - 1) / line_size;
+                auto full = size / line_size;
+                return full * chunk_size(line_size) + chunk_size(size - full * line_size)
+                    + line_count * offset_size() + (line_count - 1);
+            }
+            constexpr auto encode(char* out, const T* bytes, size_t count) const -> char* {
+                return digits_per_byte() == 8 ? write_binary_bytes(out, bytes, count) : write_hex_bytes(out, bytes, count, type == 'X');
+            }
+            static constexpr size_t capacity = 512;
+            static constexpr size_t max_small_group = 32;
+            /// Writes the groups of [offset, end) to the buffer, and returns the new size of the buffer.
+            /// The digits of up to 64 bytes are converted at once, then the groups and the separators are moved
+            /// to the buffer with fixed size copies, which may write past them.
+            template <IsSink Sink>
+            auto write_small_groups(Sink& sink, char* buffer, size_t used, size_t offset, size_t end) const -> size_t {
+                char digits[64 * 8 + max_small_group];
+                char separator_copy[max_small_group] = {};
+                std::copy(separator.begin(), separator.end(), separator_copy);
+                auto block_size = 64 / group * group;
+                for (auto block = offset; block < end; block += block_size) {
+                    auto block_end = std::min(end, block + block_size);
+                    encode(digits, data + block, block_end - block);
+                    for (auto i = block; i < block_end; i += group) {
+                        if (capacity - used < 2 * max_small_group) {
+                            sink.append(std::string_view(buffer, used));
+                            used = 0;
+                        }
+                        if (i != offset) {
+                            std::memcpy(buffer + used, separator_copy, max_small_group);
+                            used += separator.size();
+                        }
+                        auto size = std::min(group, block_end - i) * digits_per_byte();
+                        std::memcpy(buffer + used, digits + (i - block) * digits_per_byte(), max_small_group);
+                        used += size;
+                    }
+                }
+                return used;
+            }
+            /// Writes the dump through a buffer, the position in the buffer is kept out of lambdas
+            /// so that the compiler keeps it in a register between the groups.
+            template <IsSink Sink>
+            constexpr auto write(Sink& sink) const -> void {
+                char buffer[capacity];
+                size_t used = 0;
+                auto line = lines ? line_size : size;
+                auto step = group != 0 ? group : line;
+                for (size_t offset = 0; offset < size; offset += line) {
+                    auto line_end = std::min(size, offset + line);
+                    if (lines) {
+                        if (capacity - used < offset_size() + 1) {
+                            sink.append(std::string_view(buffer, used));
+                            used = 0;
+                        }
+                        auto it = buffer + used;
+                        if (offset != 0) {
+                            *it++ = '\n';
+                        }
+                        auto digits = count_digits(offset, 4);
+                        it = std::fill_n(it, offset_digits - digits, '0');
+                        it = write_power_of_2(it, static_cast<uint64_t>(offset), 4, type == 'X');
+                        *it++ = ':';
+                        *it++ = ' ';
+                        used = static_cast<size_t>(it - buffer);
+                    }
+                    if (group != 0 && group * digits_per_byte() <= max_small_group && separator.size() <= max_small_group
+                        && !std::is_constant_evaluated()) {
+                        used = write_small_groups(sink, buffer, used, offset, line_end);
+                        continue;
+                    }
+                    for (auto i = offset; i < line_end; i += step) {
+                        if (i != offset) {
+                            if (capacity - used < separator.size()) {
+                                sink.append(std::string_view(buffer, used));
+                                used = 0;
+                            }
+                            if (separator.size() > capacity) {
+                                sink.append(separator);
+                            } else {
+                                used = static_cast<size_t>(std::copy(separator.begin(), separator.end(), buffer + used) - buffer);
+                            }
+                        }
+                        auto group_end = std::min(line_end, i + step);
+                        for (auto j = i; j < group_end;) {
+                            if (capacity - used < digits_per_byte()) {
+                                sink.append(std::string_view(buffer, used));
+                                used = 0;
+                            }
+                            auto count = std::min(group_end - j, (capacity - used) / digits_per_byte());
+                            used = static_cast<size_t>(encode(buffer + used, data + j, count) - buffer);
+                            j += count;
+                        }
+                    }
+                }
+                sink.append(std::string_view(buffer, used));
+            }
+        };
+
+        /// Formats the bytes as a dump, padded as a whole.
+        template <class DescriptorType, IsSink Sink, IsByte T>
+        constexpr auto format_bytes(const Formatter<std::string_view>& formatter, const T* data, size_t size, const DescriptorType& desc, Sink& sink) -> void {
+            auto dump = ByteDump<T>(data, size, desc);
+            if (desc.width == 0) {
+                details::reserve(sink, dump.formatted_size());
+                dump.write(sink);
+                return;
+            }
+            auto dump_size = dump.formatted_size();
+            details::reserve(sink, std::max<size_t>(dump_size, desc.width));
+            formatter.format_padded(dump_size, desc, sink, [&](auto& out) {
+                dump.write(out);
+            });
+        }
+    }
+
+    /// View on a contiguous range of bytes, characters or `uint8_t`, formatted as a dump. See `cfmt::bytes`.
+    template <details::IsByte T>
+    struct Bytes {
+        std::span<const T> data;
+    };
+    /// Formats the range as a dump of its bytes instead of a container of numbers:
+    /// `cfmt::format_runtime("{:.4x}", cfmt::bytes(payload))`.
+    template <std::ranges::contiguous_range R>
+        requires details::IsByte<std::ranges::range_value_t<R>>
+    constexpr auto bytes(const R& range) -> Bytes<std::ranges::range_value_t<R>> {
+        return {std::span(std::ranges::data(range), std::ranges::size(range))};
+    }
+
+    namespace details {
+        template <class T>
+        concept IsByteRange = std::ranges::contiguous_range<const T&>
+            && std::same_as<std::ranges::range_value_t<const T&>, std::byte>;
+    }
+
+    /// Contiguous ranges of `std::byte`, eg `std::span<const std::byte>`.
+    /// The spec is "[[fill]align][#][width][.group][x|X|b][|separator|]": hex digits by default,
+    /// bytes grouped by `group` and separated by `separator`, and '#' for lines of 16 bytes with their offset.
+    template <details::IsByteRange T>
+    struct Formatter<T> : Formatter<std::string_view> {
+        static constexpr std::string_view presentation_types = "xXbB";
+
+        template <class DescriptorType, IsSink Sink>
+        constexpr auto format(const T& input, const DescriptorType& desc, Sink& sink) const -> void {
+            details::format_bytes(*this, std::ranges::data(input), std::ranges::size(input), desc, sink);
+        }
+        template <class DescriptorType>
+        constexpr auto format(const T& input, const DescriptorType& desc) const -> std::string {
+            std::string result;
+            format(input, desc, result);
+            return result;
+        }
+        template <class DescriptorType>
+        constexpr auto size_hint(const T& input, const DescriptorType& desc) const -> size_t {
+            auto size = details::ByteDump(std::ranges::data(input), std::ranges::size(input), desc).formatted_size();
+            return std::max<size_t>(size, desc.width);
+        }
+    };
+
+    template <class T>
+    struct Formatter<Bytes<T>> : Formatter<std::string_view> {
+        static constexpr std::string_view presentation_types = "xXbB";
+
+        template <class DescriptorType, IsSink Sink>
+        constexpr auto format(const Bytes<T>& input, const DescriptorType& desc, Sink& sink) const -> void {
+            details::format_bytes(*this, input.data.data(), input.data.size(), desc, sink);
+        }
+        template <class DescriptorType>
+        constexpr auto format(const Bytes<T>& input, const DescriptorType& desc) const -> std::string {
+            std::string result;
+            format(input, desc, result);
+            return result;
+        }
+        template <class DescriptorType>
+        constexpr auto size_hint(const Bytes<T>& input, const DescriptorType& desc) const -> size_t {
+            auto size = details::ByteDump(input.data.data(), input.data.size(), desc).formatted_size();
+            return std::max<size_t>(size, desc.width);
+        }
+    };
+}
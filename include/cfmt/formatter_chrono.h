@@ -0,0 +1,480 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <string_view>
+#include <type_traits>
+#include "formatter.h"
+
+namespace cfmt {
+    //chrono_format_spec ::= [[fill]align][width]["." precision]["L"][chrono_specs]
+    //chrono_specs ::= conversion specifiers of strftime ("%F %T") and literal text
+    struct ChronoDescriptor : FormatDescriptor {
+        /// Conversion specifiers, empty for the default output
+        std::string_view chrono_spec;
+
+        template <class It>
+        constexpr auto parse(It begin, It end) noexcept {
+            begin = parse_fill_align(begin, end);
+            begin = parse_width(begin, end);
+            begin = parse_precision(begin, end);
+            begin = parse_localized(begin, end);
+            if (begin != end && *begin == '%') {
+                chrono_spec = std::string_view(begin, end);
+                return end;
+            }
+            return begin;
+        }
+    };
+
+    namespace details {
+        /// Broken-down time of a second, and its text "<date> HH:MM:SS".
+        struct CivilTime {
+            int64_t seconds = std::numeric_limits<int64_t>::min();
+            int32_t year = 0;
+            uint32_t month = 0;
+            uint32_t day = 0;
+            uint32_t yday = 0;
+            uint32_t weekday = 0;
+            uint32_t hour = 0;
+            uint32_t minute = 0;
+            uint32_t second = 0;
+            /// size of the date "YYYY-MM-DD" at the start of `text`, longer for years out of [0, 9999]
+            uint32_t date_size = 0;
+            char text[32] = {};
+
+            constexpr auto date() const -> std::string_view {
+                return std::string_view(text, date_size);
+            }
+            constexpr auto time() const -> std::string_view {
+                return std::string_view(text + date_size + 1, 8);
+            }
+            constexpr auto date_time() const -> std::string_view {
+                return std::string_view(text, date_size + 9);
+            }
+        };
+        /// Fractional digits of the seconds, `digits` is 0 if the time has no sub-second precision.
+        struct ChronoFraction {
+            uint64_t value = 0;
+            int digits = 0;
+        };
+
+        constexpr auto write_2digits(char* out, uint32_t value) -> char* {
+            out[0] = digit_pairs[value*2];
+            out[1] = digit_pairs[value*2+1];
+            return out + 2;
+        }
+        /// Writes `value` with at least `count` digits, padded with zeros.
+        constexpr auto write_padded(char* out, uint64_t value, size_t count) -> char* {
+            auto digits = count_digits(value);
+            if (digits < count) {
+                out = std::fill_n(out, count - digits, '0');
+            }
+            return write_decimal(out, value);
+        }
+        constexpr auto write_year(char* out, int32_t year) -> char* {
+            if (year < 0) {
+                *out++ = '-';
+            }
+            return write_padded(out, magnitude(year), 4);
+        }
+        constexpr auto write_fraction(char* out, const ChronoFraction& fraction) -> char* {
+            if (fraction.digits == 0) {
+                return out;
+            }
+            *out++ = '.';
+            return write_padded(out, fraction.value, static_cast<size_t>(fraction.digits));
+        }
+
+        constexpr auto civil_time(int64_t seconds) -> CivilTime {
+            using namespace std::chrono;
+            auto time = sys_seconds(std::chrono::seconds(seconds));
+            auto day_point = floor<days>(time);
+            auto date = year_month_day(day_point);
+            auto clock = hh_mm_ss(time - day_point);
+            CivilTime result;
+            result.seconds = seconds;
+            result.year = static_cast<int32_t>(static_cast<int>(date.year()));
+            result.month = static_cast<unsigned>(date.month());
+            result.day = static_cast<unsigned>(date.day());
+            result.yday = static_cast<uint32_t>((day_point - sys_days(date.year()/January/1)).count()) + 1;
+            result.weekday = weekday(day_point).c_encoding();
+            result.hour = static_cast<uint32_t>(clock.hours().count());
+            result.minute = static_cast<uint32_t>(clock.minutes().count());
+            result.second = static_cast<uint32_t>(clock.seconds().count());
+
+            auto it = write_year(result.text, result.year);
+            *it++ = '-';
+            it = write_2digits(it, result.month);
+            *it++ = '-';
+            it = write_2digits(it, result.day);
+            result.date_size = static_cast<uint32_t>(it - result.text);
+            *it++ = ' ';
+            it = write_2digits(it, result.hour);
+            *it++ = ':';
+            it = write_2digits(it, result.minute);
+            *it++ = ':';
+            write_2digits(it, result.second);
+            return result;
+        }
+        /// Broken-down time of the second, computed once per second for each thread.
+        inline auto cached_civil_time(int64_t seconds) -> const CivilTime& {
+            thread_local CivilTime cache;
+            if (cache.seconds != seconds) {
+                cache = civil_time(seconds);
+            }
+            return cache;
+        }
+
+        /// Appends the literal text of `spec` and calls `convert(specifier, sink)` for each conversion specifier.
+        /// `convert` returns false for the specifiers it does not know, which are written as is.
+        template <IsSink Sink, class ConvertFn>
+        constexpr auto write_chrono_spec(Sink& sink, std::string_view spec, ConvertFn&& convert) -> void {
+            while (!spec.empty()) {
+                auto pos = spec.find('%');
+                if (pos != 0) {
+                    sink.append(spec.substr(0, pos));
+                    if (pos == std::string_view::npos) {
+                        return;
+                    }
+                }
+                if (pos + 1 == spec.size()) {
+                    sink.append(spec.substr(pos));
+                    return;
+                }
+                auto specifier = spec[pos+1];
+                switch (specifier) {
+                    case '%': sink.append(1, '%'); break;
+                    case 'n': sink.append(1, '\n'); break;
+                    case 't': sink.append(1, '\t'); break;
+                    default:
+                        if (!convert(specifier, sink)) {
+                            sink.append(spec.substr(pos, 2));
+                        }
+                        break;
+                }
+                spec.remove_prefix(pos + 2);
+            }
+        }
+        /// Checks the spec parsed into `desc`: every conversion specifier must be in `specifiers`.
+        constexpr auto check_chrono_desc(const ChronoDescriptor& desc, const char* parse_end, const char* spec_end, std::string_view specifiers) -> const char* {
+            if (parse_end != spec_end) {
+                return "invalid format spec";
+            }
+            auto chrono_spec = desc.chrono_spec;
+            for (auto pos = chrono_spec.find('%'); pos != std::string_view::npos; pos = chrono_spec.find('%', pos + 2)) {
+                if (pos + 1 == chrono_spec.size()) {
+                    return "missing conversion specifier after '%'";
+                }
+                if (std::string_view("%nt").find(chrono_spec[pos+1]) == std::string_view::npos
+                    && specifiers.find(chrono_spec[pos+1]) == std::string_view::npos) {
+                    return "invalid conversion specifier for the argument";
+                }
+            }
+            return nullptr;
+        }
+        /// Checks that every conversion specifier of `spec` is in `specifiers`.
+        constexpr auto check_chrono_spec(std::string_view spec, std::string_view specifiers) -> const char* {
+            ChronoDescriptor desc;
+            auto end = desc.parse(spec.data(), spec.data() + spec.size());
+            return check_chrono_desc(desc, end, spec.data() + spec.size(), specifiers);
+        }
+        /// Parses the spec, and throws `format_error` if `check_chrono_spec` rejects it.
+        constexpr auto parse_chrono_spec(std::string_view spec, std::string_view specifiers) -> ChronoDescriptor {
+            ChronoDescriptor desc;
+            auto end = desc.parse(spec.data(), spec.data() + spec.size());
+            if (auto error = check_chrono_desc(desc, end, spec.data() + spec.size(), specifiers); error != nullptr) {
+                ThrowErrors{}(error);
+            }
+            return desc;
+        }
+
+        inline constexpr std::string_view weekday_names[] = {"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
+        inline constexpr std::string_view month_names[] = {"January", "February", "March", "April", "May", "June",
+            "July", "August", "September", "October", "November", "December"};
+
+        /// Writes a conversion specifier of a date and time. Returns false if `specifier` is not one.
+        template <IsSink Sink>
+        constexpr auto write_civil(Sink& sink, char specifier, const CivilTime& civil, const ChronoFraction& fraction) -> bool {
+            char buffer[32];
+            auto it = buffer;
+            switch (specifier) {
+                case 'F': sink.append(civil.date()); return true;
+                case 'T':
+                    sink.append(civil.time());
+                    sink.append(std::string_view(buffer, write_fraction(buffer, fraction)));
+                    return true;
+                case 'Y': it = write_year(it, civil.year); break;
+                case 'y': it = write_2digits(it, static_cast<uint32_t>((civil.year % 100 + 100) % 100)); break;
+                case 'C': {
+                    auto century = civil.year >= 0 ? civil.year / 100 : -((-civil.year + 99) / 100);
+                    if (century < 0) {
+                        *it++ = '-';
+                    }
+                    it = write_padded(it, magnitude(century), 2);
+                    break;
+                }
+                case 'm': it = write_2digits(it, civil.month); break;
+                case 'd': it = write_2digits(it, civil.day); break;
+                case 'e':
+                    *it++ = civil.day < 10 ? ' ' : static_cast<char>('0' + civil.day / 10);
+                    *it++ = static_cast<char>('0' + civil.day % 10);
+                    break;
+                case 'j': it = write_padded(it, civil.yday, 3); break;
+                case 'D':
+                    it = write_2digits(it, civil.month);
+                    *it++ = '/';
+                    it = write_2digits(it, civil.day);
+                    *it++ = '/';
+                    it = write_2digits(it, static_cast<uint32_t>((civil.year % 100 + 100) % 100));
+                    break;
+                case 'H': it = write_2digits(it, civil.hour); break;
+                case 'I': it = write_2digits(it, (civil.hour + 11) % 12 + 1); break;
+                case 'p': sink.append(civil.hour < 12 ? "AM" : "PM"); return true;
+                case 'M': it = write_2digits(it, civil.minute); break;
+                case 'S':
+                    it = write_2digits(it, civil.second);
+                    it = write_fraction(it, fraction);
+                    break;
+                case 'R': sink.append(civil.time().substr(0, 5)); return true;
+                case 'a': sink.append(weekday_names[civil.weekday].substr(0, 3)); return true;
+                case 'A': sink.append(weekday_names[civil.weekday]); return true;
+                case 'b':
+                case 'h': sink.append(month_names[civil.month-1].substr(0, 3)); return true;
+                case 'B': sink.append(month_names[civil.month-1]); return true;
+                case 'u': *it++ = static_cast<char>('0' + (civil.weekday == 0 ? 7 : civil.weekday)); break;
+                case 'w': *it++ = static_cast<char>('0' + civil.weekday); break;
+                default: return false;
+            }
+            sink.append(std::string_view(buffer, it));
+            return true;
+        }
+
+        /// Unit suffix of a duration, eg "ms" for milliseconds.
+        template <class Period>
+        constexpr auto duration_suffix(char* out) -> char* {
+            auto append = [&out](std::string_view suffix) {
+                out = std::copy(suffix.begin(), suffix.end(), out);
+                return out;
+            };
+            using std::ratio_equal_v;
+            if constexpr (ratio_equal_v<Period, std::atto>) return append("as");
+            else if constexpr (ratio_equal_v<Period, std::femto>) return append("fs");
+            else if constexpr (ratio_equal_v<Period, std::pico>) return append("ps");
+            else if constexpr (ratio_equal_v<Period, std::nano>) return append("ns");
+            else if constexpr (ratio_equal_v<Period, std::micro>) return append("µs");
+            else if constexpr (ratio_equal_v<Period, std::milli>) return append("ms");
+            else if constexpr (ratio_equal_v<Period, std::centi>) return append("cs");
+            else if constexpr (ratio_equal_v<Period, std::deci>) return append("ds");
+            else if constexpr (ratio_equal_v<Period, std::ratio<1>>) return append("s");
+            else if constexpr (ratio_equal_v<Period, std::deca>) return append("das");
+            else if constexpr (ratio_equal_v<Period, std::hecto>) return append("hs");
+            else if constexpr (ratio_equal_v<Period, std::kilo>) return append("ks");
+            else if constexpr (ratio_equal_v<Period, std::mega>) return append("Ms");
+            else if constexpr (ratio_equal_v<Period, std::giga>) return append("Gs");
+            else if constexpr (ratio_equal_v<Period, std::tera>) return append("Ts");
+            else if constexpr (ratio_equal_v<Period, std::peta>) return append("Ps");
+            else if constexpr (ratio_equal_v<Period, std::exa>) return append("Es");
+            else if constexpr (ratio_equal_v<Period, std::ratio<60>>) return append("min");
+            else if constexpr (ratio_equal_v<Period, std::ratio<3600>>) return append("h");
+            else if constexpr (ratio_equal_v<Period, std::ratio<86400>>) return append("d");
+            else {
+                *out++ = '[';
+                out = write_decimal(out, static_cast<uint64_t>(Period::num));
+                if constexpr (Period::den != 1) {
+                    *out++ = '/';
+                    out = write_decimal(out, static_cast<uint64_t>(Period::den));
+                }
+                return append("]s");
+            }
+        }
+    }
+
+    /// Time points of the system clock and local times.
+    /// The default output is "%F %T", eg "2024-05-17 12:34:56.789" for a time point in milliseconds.
+    /// The precision limits the sub-second digits: "{:.3}" writes the milliseconds of a time point in nanoseconds.
+    /// The date and time of a second are rendered once per thread and reused until the next second,
+    /// so the time points of a log only render their sub-second digits.
+    template <class Clock, class Duration>
+        requires std::same_as<Clock, std::chrono::system_clock> || std::same_as<Clock, std::chrono::local_t>
+    struct Formatter<std::chrono::time_point<Clock, Duration>> : Formatter<std::string_view> {
+        using TimePoint = std::chrono::time_point<Clock, Duration>;
+        /// Conversion specifiers of the spec, checked with the format strings known at compile time.
+        static constexpr std::string_view specifiers = std::same_as<Clock, std::chrono::system_clock>
+            ? "FTYyCmdejDHIpMSRaAbhBuwzZ" : "FTYyCmdejDHIpMSRaAbhBuw";
+        static constexpr std::string_view presentation_types = "";
+
+        /// Runtime specs get the checks of the format strings known at compile time.
+        static constexpr bool parse_checks_spec = true;
+        constexpr auto parse(std::string_view input) const -> ChronoDescriptor {
+            return details::parse_chrono_spec(input, specifiers);
+        }
+        static constexpr auto check_spec(std::string_view spec) -> const char* {
+            return details::check_chrono_spec(spec, specifiers);
+        }
+        template <class DescriptorType, IsSink Sink>
+        constexpr auto format(const TimePoint& input, const DescriptorType& desc, Sink& sink) const -> void {
+            using Precise = std::common_type_t<Duration, std::chrono::seconds>;
+            using Clock24 = std::chrono::hh_mm_ss<Precise>;
+            auto time = std::chrono::time_point_cast<Precise>(input).time_since_epoch();
+            auto seconds = std::chrono::floor<std::chrono::seconds>(time);
+            auto fraction = details::ChronoFraction{};
+            if constexpr (Clock24::fractional_width > 0) {
+                using Fraction = typename Clock24::precision;
+                fraction.value = static_cast<uint64_t>(std::chrono::duration_cast<Fraction>(time - seconds).count());
+                fraction.digits = static_cast<int>(Clock24::fractional_width);
+                if (desc.precision && *desc.precision < Clock24::fractional_width) {
+                    fraction.value /= details::powers_of_10[Clock24::fractional_width - *desc.precision];
+                    fraction.digits = static_cast<int>(*desc.precision);
+                }
+            }
+            std::string_view spec;
+            if constexpr (requires { desc.chrono_spec; }) {
+                spec = desc.chrono_spec;
+            }
+            auto write = [&](const details::CivilTime& civil) {
+                if (desc.width == 0) {
+                    write_spec(sink, spec, civil, fraction);
+                    return;
+                }
+                details::WidthCountingSink counter;
+                write_spec(counter, spec, civil, fraction);
+                format_padded(counter.width, desc, sink, [&](auto& out) {
+                    write_spec(out, spec, civil, fraction);
+                });
+            };
+            if (std::is_constant_evaluated()) {
+                write(details::civil_time(seconds.count()));
+            } else {
+                write(details::cached_civil_time(seconds.count()));
+            }
+        }
+        template <class DescriptorType>
+        constexpr auto format(const TimePoint& input, const DescriptorType& desc) const -> std::string {
+            std::string result;
+            format(input, desc, result);
+            return result;
+        }
+    private:
+        template <IsSink Sink>
+        static constexpr auto write_spec(Sink& sink, std::string_view spec, const details::CivilTime& civil, const details::ChronoFraction& fraction) -> void {
+            if (spec.empty() || spec == "%F %T") {
+                char buffer[32];
+                sink.append(civil.date_time());
+                sink.append(std::string_view(buffer, details::write_fraction(buffer, fraction)));
+                return;
+            }
+            details::write_chrono_spec(sink, spec, [&](char specifier, auto& out) {
+                if constexpr (std::same_as<Clock, std::chrono::system_clock>) {
+                    if (specifier == 'z') {
+                        out.append("+0000");
+                        return true;
+                    }
+                    if (specifier == 'Z') {
+                        out.append("UTC");
+                        return true;
+                    }
+                }
+                return details::write_civil(out, specifier, civil, fraction);
+            });
+        }
+    };
+
+    /// Durations. The default output is the count followed by the unit, eg "42ms".
+    /// The spec may give the hours, minutes and seconds of the duration ("%T", "%H", "%M", "%S", "%R"),
+    /// its count ("%Q") and its unit ("%q"). Negative durations are preceded by '-'.
+    template <class Rep, class Period>
+        requires std::is_arithmetic_v<Rep>
+    struct Formatter<std::chrono::duration<Rep, Period>> : Formatter<std::string_view> {
+        using Duration = std::chrono::duration<Rep, Period>;
+        static constexpr std::string_view specifiers = "HMSTRQq";
+        static constexpr std::string_view presentation_types = "";
+
+        /// Runtime specs get the checks of the format strings known at compile time.
+        static constexpr bool parse_checks_spec = true;
+        constexpr auto parse(std::string_view input) const -> ChronoDescriptor {
+            return details::parse_chrono_spec(input, specifiers);
+        }
+        static constexpr auto check_spec(std::string_view spec) -> const char* {
+            return details::check_chrono_spec(spec, specifiers);
+        }
+        template <class DescriptorType, IsSink Sink>
+        constexpr auto format(const Duration& input, const DescriptorType& desc, Sink& sink) const -> void {
+            std::string_view spec;
+            if constexpr (requires { desc.chrono_spec; }) {
+                spec = desc.chrono_spec;
+            }
+            if (desc.width == 0) {
+                write_spec(sink, spec, input);
+                return;
+            }
+            details::WidthCountingSink counter;
+            write_spec(counter, spec, input);
+            format_padded(counter.width, desc, sink, [&](auto& out) {
+                write_spec(out, spec, input);
+            });
+        }
+        template <class DescriptorType>
+        constexpr auto format(const Duration& input, const DescriptorType& desc) const -> std::string {
+            std::string result;
+            format(input, desc, result);
+            return result;
+        }
+    private:
+        template <IsSink Sink>
+        static constexpr auto write_count(Sink& sink, Rep count) -> void {
+            Formatter<Rep>{}.format(count, FormatDescriptor{}, sink);
+        }
+        template <IsSink Sink>
+        static constexpr auto write_spec(Sink& sink, std::string_view spec, const Duration& input) -> void {
+            char buffer[48];
+            if (spec.empty()) {
+                write_count(sink, input.count());
+                sink.append(std::string_view(buffer, details::duration_suffix<Period>(buffer)));
+                return;
+            }
+            auto negative = input < Duration::zero();
+            auto value = negative ? -input : input;
+            if (negative) {
+                sink.append(1, '-');
+            }
+            using IntegralDuration = std::chrono::duration<std::conditional_t<std::is_floating_point_v<Rep>, int64_t, Rep>, Period>;
+            using Precise = std::common_type_t<IntegralDuration, std::chrono::seconds>;
+            using Clock24 = std::chrono::hh_mm_ss<Precise>;
+            auto clock = Clock24(std::chrono::duration_cast<Precise>(value));
+            auto fraction = details::ChronoFraction{};
+            if constexpr (Clock24::fractional_width > 0) {
+                fraction.value = static_cast<uint64_t>(clock.subseconds().count());
+                fraction.digits = static_cast<int>(Clock24::fractional_width);
+            }
+            details::write_chrono_spec(sink, spec, [&](char specifier, auto& out) {
+                auto it = buffer;
+                switch (specifier) {
+                    case 'H': it = details::write_padded(it, static_cast<uint64_t>(clock.hours().count()), 2); break;
+                    case 'M': it = details::write_2digits(it, static_cast<uint32_t>(clock.minutes().count())); break;
+                    case 'S':
+                        it = details::write_2digits(it, static_cast<uint32_t>(clock.seconds().count()));
+                        it = details::write_fraction(it, fraction);
+                        break;
+                    case 'R':
+                    case 'T':
+                        it = details::write_padded(it, static_cast<uint64_t>(clock.hours().count()), 2);
+                        *it++ = ':';
+                        it = details::write_2digits(it, static_cast<uint32_t>(clock.minutes().count()));
+                        if (specifier == 'T') {
+                            *it++ = ':';
+                            it = details::write_2digits(it, static_cast<uint32_t>(clock.seconds().count()));
+                            it = details::write_fraction(it, fraction);
+                        }
+                        break;
+                    case 'Q': write_count(out, value.count()); return true;
+                    case 'q': it = details::duration_suffix<Period>(it); break;
+                    default: return false;
+                }
+                out.append(std::string_view(buffer, it));
+                return true;
+            });
+        }
+    };
+}
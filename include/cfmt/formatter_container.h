@@ -1,43 +1,120 @@
 #pragma once
 #include "formatter.h"
 namespace cfmt {
+    namespace details {
+        /// Writes the items of [begin, end) separated by the range separator, without the brackets.
+        template <class It, class DescriptorType, IsSink Sink>
+        constexpr auto format_range_items(It begin, It end, const DescriptorType& item_desc, Sink& sink) -> void {
+            using ValueType = std::remove_cvref_t<decltype(*begin)>;
+            auto separator = range_separator(item_desc);
+            auto formatter = Formatter<ValueType>{};
+            if (begin != end) {
+                format_to_sink(formatter, *begin, item_desc, sink);
+                ++begin;
+            }
+            for (; begin != end; ++begin) {
+                sink.append(separator);
+                format_to_sink(formatter, *begin, item_desc, sink);
+            }
+        }
+    }
+    namespace details {
+        /// Ranges of pairs are formatted as maps by cfmt/formatter_map.h, even if the pairs are formatable.
+        template <class T>
+        concept IsPairRange = requires {
+            typename std::remove_cvref_t<decltype(*std::begin(std::declval<T>()))>::first_type;
+            typename std::remove_cvref_t<decltype(*std::begin(std::declval<T>()))>::second_type;
+        };
+    }
     template <class T>
     concept IsFormatableContainer = requires(T t) {
         std::begin(t);
         std::end(t);
-    } && IsFormatable<std::remove_cvref_t<decltype(*std::begin(std::declval<T>()))>>;
+    } && IsFormatable<std::remove_cvref_t<decltype(*std::begin(std::declval<T>()))>>
+        && !std::convertible_to<T, std::string_view>
+        && !details::IsPairRange<T>;
     template <IsFormatableContainer T>
     struct Formatter<T> : Formatter<std::string_view> {
         using ValueType = std::remove_cvref_t<decltype(*std::begin(std::declval<T>()))>;
+        /// The spec applies to the items, its type is not checked if their formatter does not declare its types
+        static constexpr std::optional<std::string_view> presentation_types = details::presentation_types_of<Formatter<ValueType>>();
+        template <class DescriptorType, IsSink Sink>
+        constexpr auto format(const T& input, const DescriptorType& desc, Sink& sink) const -> void {
+            auto item_desc = items_descriptor(desc);
+            if (desc.width == 0) {
+                if constexpr (details::HasSizeHint<Formatter<ValueType>, ValueType, DescriptorType>) {
+                    details::reserve(sink, items_size(input, item_desc));
+                }
+                format_items(input, item_desc, sink);
+            } else {
+                // the width is measured without writing the items, which are then written once around the fill
+                auto width = items_width(input, item_desc);
+                if constexpr (details::HasSizeHint<Formatter<ValueType>, ValueType, DescriptorType>) {
+                    details::reserve(sink, items_size(input, item_desc) + (width < desc.width ? desc.width - width : 0));
+                }
+                format_padded(width, desc, sink, [&](auto& out) {
+                    format_items(input, item_desc, out);
+                });
+            }
+        }
         template <class DescriptorType>
         constexpr auto format(const T& input, const DescriptorType& desc) const -> std::string {
-            constexpr std::string_view default_separator = ", ";
             std::string result;
-            auto size = std::distance(std::begin(input), std::end(input));
-            // auto separator = desc.separator.value_or(default_separator);
-            if constexpr (std::convertible_to<ValueType, std::string_view>) {
-                size_t total_size = 0;
-                for (const auto& item : input) {
-                    total_size += std::string_view(item).length();
-                }
-                result.reserve(total_size + (size-1)*default_separator.length());
-            }
-            result.append(1, '{');
-            auto begin = std::begin(input);
-            auto end = std::end(input);
-            auto desc_copy = desc;
-            desc_copy.fill_align = std::nullopt;
-            desc_copy.width = 0;
-            if (begin != end) {
-                result.append(Formatter<ValueType>{}.format(*begin, desc_copy));
-                ++begin;
+            format(input, desc, result);
+            return result;
+        }
+        template <class DescriptorType>
+            requires details::HasSizeHint<Formatter<ValueType>, ValueType, DescriptorType>
+        constexpr auto size_hint(const T& input, const DescriptorType& desc) const -> size_t {
+            auto item_desc = items_descriptor(desc);
+            auto size = items_size(input, item_desc);
+            if (desc.width == 0) {
+                return size;
             }
-            for (; begin != end; ++begin) {
-                result.append(default_separator);
-                result.append(Formatter<ValueType>{}.format(*begin, desc_copy));
+            auto width = items_width(input, item_desc);
+            return size + (width < desc.width ? desc.width - width : 0);
+        }
+    private:
+        template <class DescriptorType>
+        static constexpr auto items_descriptor(const DescriptorType& desc) -> DescriptorType {
+            return details::range_items_descriptor(desc);
+        }
+        template <class DescriptorType>
+        constexpr auto items_size(const T& input, const DescriptorType& item_desc) const -> size_t {
+            auto separator = details::range_separator(item_desc);
+            auto formatter = Formatter<ValueType>{};
+            size_t size = details::range_brackets(item_desc).size();
+            size_t count = 0;
+            for (const auto& item : input) {
+                size += details::formatted_size_of(formatter, item, item_desc);
+                ++count;
             }
-            result.append(1, '}');
-            return Formatter<std::string_view>::format(result, desc);
+            if (count > 1) {
+                size += (count-1)*separator.size();
+            }
+            return size;
+        }
+        /// Display width of the items, used for the padding. The numbers are measured by their size hints.
+        template <class DescriptorType>
+        constexpr auto items_width(const T& input, const DescriptorType& item_desc) const -> size_t {
+            auto formatter = Formatter<ValueType>{};
+            size_t width = details::display_width(details::range_brackets(item_desc));
+            size_t count = 0;
+            for (const auto& item : input) {
+                width += details::formatted_width_of(formatter, item, item_desc);
+                ++count;
+            }
+            if (count > 1) {
+                width += (count-1)*details::display_width(details::range_separator(item_desc));
+            }
+            return width;
+        }
+        template <class DescriptorType, IsSink Sink>
+        constexpr auto format_items(const T& input, const DescriptorType& item_desc, Sink& sink) const -> void {
+            auto brackets = details::range_brackets(item_desc);
+            sink.append(brackets.substr(0, brackets.size()/2));
+            details::format_range_items(std::begin(input), std::end(input), item_desc, sink);
+            sink.append(brackets.substr(brackets.size()/2));
         }
     };
-}
\ No newline at end of file
+}
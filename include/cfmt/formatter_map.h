@@ -16,42 +16,118 @@ namespace cfmt {
     template <details::IsFormatableMap T>
     struct Formatter<T> : Formatter<std::string_view> {
         using ValueType = details::ValueMapType<T>;
+        using KeyType = typename ValueType::first_type;
+        using MappedType = typename ValueType::second_type;
+        static constexpr std::string_view separator_key_value = ": ";
+        /// The spec applies to the keys and the values, the type is checked against the values
+        static constexpr std::optional<std::string_view> presentation_types = details::presentation_types_of<Formatter<MappedType>>();
+
+        template <class DescriptorType, IsSink Sink>
+        constexpr auto format(const T& input, const DescriptorType& desc, Sink& sink) const -> void {
+            auto item_desc = items_descriptor(desc);
+            if (desc.width == 0) {
+                if constexpr (has_size_hint<DescriptorType>) {
+                    details::reserve(sink, items_size(input, item_desc));
+                }
+                format_items(input, item_desc, sink);
+            } else {
+                // the width is measured without writing the items, which are then written once around the fill
+                auto width = items_width(input, item_desc);
+                if constexpr (has_size_hint<DescriptorType>) {
+                    details::reserve(sink, items_size(input, item_desc) + (width < desc.width ? desc.width - width : 0));
+                }
+                format_padded(width, desc, sink, [&](auto& out) {
+                    format_items(input, item_desc, out);
+                });
+            }
+        }
         template <class DescriptorType>
         constexpr auto format(const T& input, const DescriptorType& desc) const -> std::string {
-            constexpr std::string_view separator = ", ";
             std::string result;
-            auto size = std::distance(std::begin(input), std::end(input));
-            // auto separator = desc.separator.value_or(default_separator);
-            if constexpr (std::convertible_to<ValueType, std::string_view>) {
-                size_t total_size = 0;
-                for (const auto& item : input) {
-                    total_size += std::string_view(item).length();
-                }
-                result.reserve(total_size + (size-1)*separator.length());
+            format(input, desc, result);
+            return result;
+        }
+        template <class DescriptorType>
+            requires details::HasSizeHint<Formatter<KeyType>, KeyType, DescriptorType>
+                && details::HasSizeHint<Formatter<MappedType>, MappedType, DescriptorType>
+        constexpr auto size_hint(const T& input, const DescriptorType& desc) const -> size_t {
+            auto item_desc = items_descriptor(desc);
+            auto size = items_size(input, item_desc);
+            if (desc.width == 0) {
+                return size;
             }
-            
-            result.append(1, '{');
+            auto width = items_width(input, item_desc);
+            return size + (width < desc.width ? desc.width - width : 0);
+        }
+    private:
+        template <class DescriptorType>
+        static constexpr bool has_size_hint = details::HasSizeHint<Formatter<KeyType>, KeyType, DescriptorType>
+            && details::HasSizeHint<Formatter<MappedType>, MappedType, DescriptorType>;
+
+        /// The keys and values are formatted with the descriptor of the map, without its padding.
+        template <class DescriptorType>
+        static constexpr auto items_descriptor(const DescriptorType& desc) -> DescriptorType {
+            return details::range_items_descriptor(desc);
+        }
+        template <class DescriptorType>
+        constexpr auto items_size(const T& input, const DescriptorType& item_desc) const -> size_t {
+            auto separator = details::range_separator(item_desc);
+            auto key_formatter = Formatter<KeyType>{};
+            auto value_formatter = Formatter<MappedType>{};
+            size_t size = details::range_brackets(item_desc).size();
+            size_t count = 0;
+            for (const auto& item : input) {
+                size += details::formatted_size_of(key_formatter, item.first, item_desc)
+                    + separator_key_value.size()
+                    + details::formatted_size_of(value_formatter, item.second, item_desc);
+                ++count;
+            }
+            if (count > 1) {
+                size += (count-1)*separator.size();
+            }
+            return size;
+        }
+        /// Display width of the items, used for the padding. The numbers are measured by their size hints.
+        template <class DescriptorType>
+        constexpr auto items_width(const T& input, const DescriptorType& item_desc) const -> size_t {
+            auto key_formatter = Formatter<KeyType>{};
+            auto value_formatter = Formatter<MappedType>{};
+            size_t width = details::display_width(details::range_brackets(item_desc));
+            size_t count = 0;
+            for (const auto& item : input) {
+                width += details::formatted_width_of(key_formatter, item.first, item_desc)
+                    + details::display_width(separator_key_value)
+                    + details::formatted_width_of(value_formatter, item.second, item_desc);
+                ++count;
+            }
+            if (count > 1) {
+                width += (count-1)*details::display_width(details::range_separator(item_desc));
+            }
+            return width;
+        }
+        template <class DescriptorType, IsSink Sink>
+        constexpr auto format_items(const T& input, const DescriptorType& item_desc, Sink& sink) const -> void {
+            auto separator = details::range_separator(item_desc);
+            auto brackets = details::range_brackets(item_desc);
+            sink.append(brackets.substr(0, brackets.size()/2));
             auto begin = std::begin(input);
             auto end = std::end(input);
-            auto desc_copy = desc;
-            desc_copy.fill_align = std::nullopt;
-            desc_copy.width = 0;
-            auto append = [&result, desc_copy](const auto& item) {
-                constexpr std::string_view separator_key_value = ": ";
-                result.append(Formatter<typename ValueType::first_type>{}.format(item.first, desc_copy));
-                result.append(separator_key_value);
-                result.append(Formatter<typename ValueType::second_type>{}.format(item.second, desc_copy));
+            auto key_formatter = Formatter<KeyType>{};
+            auto value_formatter = Formatter<MappedType>{};
+            auto append = [&](const auto& item) {
+                details::format_to_sink(key_formatter, item.first, item_desc, sink);
+                sink.append(separator_key_value);
+                details::format_to_sink(value_formatter, item.second, item_desc, sink);
             };
             if (begin != end) {
                 append(*begin);
                 ++begin;
             }
             for (; begin != end; ++begin) {
-                result.append(separator);
+                sink.append(separator);
                 append(*begin);
             }
-            result.append(1, '}');
-            return Formatter<std::string_view>::format(result, desc);
+            sink.append(brackets.substr(brackets.size()/2));
         }
     };
-}
\ No newline at end of file
+}
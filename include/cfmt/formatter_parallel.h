@@ -0,0 +1,229 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <ranges>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "formatter_container.h"
+
+namespace cfmt {
+    /// Options of `cfmt::parallel`.
+    struct ParallelOptions {
+        /// ranges with fewer items are formatted on the calling thread
+        size_t min_size = size_t(1) << 16;
+        /// threads formatting the range, the calling thread included, 0 for the hardware concurrency
+        unsigned threads = 0;
+    };
+
+    /// Contiguous range formatted by several threads. See `cfmt::parallel`.
+    template <std::ranges::contiguous_range R>
+    struct Parallel {
+        const R& range;
+        ParallelOptions options;
+    };
+    /// Formats the range on several threads when it has at least `options.min_size` items.
+    /// The output is the same as the output of the range: `cfmt::format_runtime("{:x}", cfmt::parallel(values))`.
+    template <std::ranges::contiguous_range R>
+        requires IsFormatableContainer<R>
+    constexpr auto parallel(const R& range, ParallelOptions options = {}) -> Parallel<R> {
+        return {range, options};
+    }
+
+    namespace details {
+        /// Calls `fn(index)` for every index in [0, count) on `threads` threads, the calling thread included.
+        /// The first exception thrown by `fn` is rethrown once all the threads are done.
+        template <class Fn>
+        auto parallel_for(size_t count, unsigned threads, Fn&& fn) -> void {
+            std::atomic<size_t> next = 0;
+            std::exception_ptr error;
+            std::mutex error_mutex;
+            auto work = [&] {
+                for (auto i = next++; i < count; i = next++) {
+                    try {
+                        fn(i);
+                    } catch (...) {
+                        std::lock_guard lock(error_mutex);
+                        if (!error) {
+                            error = std::current_exception();
+                        }
+                    }
+                }
+            };
+            {
+                std::vector<std::jthread> workers;
+                workers.reserve(threads - 1);
+                for (unsigned i = 1; i < threads; ++i) {
+                    workers.emplace_back(work);
+                }
+                work();
+            }
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+    /// The range is split into a few chunks per thread. When the items have exact size hints, the chunks are sized first
+    /// and then written in place into the sink, or into one buffer when the output is padded or the sink can not give
+    /// its memory. Otherwise each chunk is formatted into its own string, and the strings are appended in order.
+    template <class R>
+    struct Formatter<Parallel<R>> : Formatter<R> {
+        using ValueType = typename Formatter<R>::ValueType;
+
+        template <class DescriptorType, IsSink Sink>
+        constexpr auto format(const Parallel<R>& input, const DescriptorType& desc, Sink& sink) const -> void {
+            if (std::is_constant_evaluated() || std::ranges::size(input.range) < std::max<size_t>(input.options.min_size, 2)) {
+                Formatter<R>::format(input.range, desc, sink);
+            } else {
+                format_parallel(input, desc, sink);
+            }
+        }
+        template <class DescriptorType>
+        constexpr auto format(const Parallel<R>& input, const DescriptorType& desc) const -> std::string {
+            std::string result;
+            format(input, desc, result);
+            return result;
+        }
+    private:
+        static constexpr unsigned chunks_per_thread = 4;
+
+        using Pointer = decltype(std::ranges::data(std::declval<const R&>()));
+        /// Items of the chunk `index` out of `count`.
+        static auto chunk_items(const R& range, size_t index, size_t count) -> std::pair<Pointer, Pointer> {
+            auto data = std::ranges::data(range);
+            auto size = std::ranges::size(range);
+            return {data + size * index / count, data + size * (index + 1) / count};
+        }
+
+        template <class DescriptorType, IsSink Sink>
+        auto format_parallel(const Parallel<R>& input, const DescriptorType& desc, Sink& sink) const -> void {
+            auto threads = input.options.threads != 0 ? input.options.threads : std::max(1u, std::thread::hardware_concurrency());
+            auto chunk_count = std::min<size_t>(std::ranges::size(input.range), static_cast<size_t>(threads) * chunks_per_thread);
+            auto thread_count = static_cast<unsigned>(std::min<size_t>(threads, chunk_count));
+            if constexpr (details::HasSizeHint<Formatter<ValueType>, ValueType, DescriptorType>) {
+                format_sized(input.range, desc, chunk_count, thread_count, sink);
+            } else {
+                format_chunks(input.range, desc, chunk_count, thread_count, sink);
+            }
+        }
+
+        /// Sizes the chunks from the size hints of the items, then formats each one at its offset.
+        template <class DescriptorType, IsSink Sink>
+        auto format_sized(const R& range, const DescriptorType& desc, size_t chunk_count, unsigned threads, Sink& sink) const -> void {
+            auto item_desc = details::range_items_descriptor(desc);
+            auto separator = details::range_separator(item_desc);
+            auto brackets = details::range_brackets(item_desc);
+            auto opening = brackets.substr(0, brackets.size()/2);
+            auto closing = brackets.substr(brackets.size()/2);
+
+            // offsets[i] is the start of the chunk i, which begins with a separator except for the first chunk
+            std::vector<size_t> offsets(chunk_count + 1);
+            details::parallel_for(chunk_count, threads, [&](size_t i) {
+                auto [begin, end] = chunk_items(range, i, chunk_count);
+                auto formatter = Formatter<ValueType>{};
+                // every item is preceded by a separator, except the first one of the range
+                auto separators = static_cast<size_t>(end - begin) - (i == 0 ? 1 : 0);
+                size_t chunk_size = separators * separator.size();
+                for (auto it = begin; it != end; ++it) {
+                    chunk_size += formatter.size_hint(*it, item_desc);
+                }
+                offsets[i + 1] = chunk_size;
+            });
+            offsets[0] = opening.size();
+            for (size_t i = 0; i < chunk_count; ++i) {
+                offsets[i + 1] += offsets[i];
+            }
+            auto total = offsets.back() + closing.size();
+
+            std::string buffer;
+            auto out = desc.width == 0 ? details::append_buffer(sink, total) : nullptr;
+            auto in_place = out != nullptr;
+            if (!in_place) {
+                buffer.resize(total);
+                out = buffer.data();
+            }
+            std::vector<size_t> widths(desc.width != 0 ? chunk_count : 0);
+            std::copy(opening.begin(), opening.end(), out);
+            details::parallel_for(chunk_count, threads, [&](size_t i) {
+                auto [begin, end] = chunk_items(range, i, chunk_count);
+                IteratorSink<char*> chunk{out + offsets[i]};
+                if (i != 0) {
+                    chunk.append(separator);
+                }
+                details::format_range_items(begin, end, item_desc, chunk);
+                if (!widths.empty()) {
+                    widths[i] = details::display_width(std::string_view(out + offsets[i], offsets[i + 1] - offsets[i]));
+                }
+            });
+            std::copy(closing.begin(), closing.end(), out + offsets.back());
+            if (in_place) {
+                return;
+            }
+
+            auto write = [&](auto& out) {
+                out.append(buffer);
+            };
+            if (desc.width == 0) {
+                details::reserve(sink, total);
+                write(sink);
+                return;
+            }
+            auto width = details::display_width(brackets);
+            for (auto chunk_width : widths) {
+                width += chunk_width;
+            }
+            details::reserve(sink, total + (width < desc.width ? desc.width - width : 0));
+            this->format_padded(width, desc, sink, write);
+        }
+
+        /// Formats the chunks into their own strings, then appends them in order.
+        template <class DescriptorType, IsSink Sink>
+        auto format_chunks(const R& range, const DescriptorType& desc, size_t chunk_count, unsigned threads, Sink& sink) const -> void {
+            auto item_desc = details::range_items_descriptor(desc);
+            auto separator = details::range_separator(item_desc);
+            auto brackets = details::range_brackets(item_desc);
+
+            std::vector<std::string> chunks(chunk_count);
+            std::vector<size_t> widths(desc.width != 0 ? chunk_count : 0);
+            details::parallel_for(chunk_count, threads, [&](size_t i) {
+                auto [begin, end] = chunk_items(range, i, chunk_count);
+                details::format_range_items(begin, end, item_desc, chunks[i]);
+                if (!widths.empty()) {
+                    widths[i] = details::display_width(chunks[i]);
+                }
+            });
+
+            auto write = [&](auto& out) {
+                out.append(brackets.substr(0, brackets.size()/2));
+                for (size_t i = 0; i < chunk_count; ++i) {
+                    if (i != 0) {
+                        out.append(separator);
+                    }
+                    out.append(chunks[i]);
+                }
+                out.append(brackets.substr(brackets.size()/2));
+            };
+            size_t total = brackets.size() + (chunk_count - 1) * separator.size();
+            for (const auto& chunk : chunks) {
+                total += chunk.size();
+            }
+            if (desc.width == 0) {
+                details::reserve(sink, total);
+                write(sink);
+                return;
+            }
+            auto width = details::display_width(brackets) + (chunk_count - 1) * details::display_width(separator);
+            for (auto chunk_width : widths) {
+                width += chunk_width;
+            }
+            details::reserve(sink, total + (width < desc.width ? desc.width - width : 0));
+            this->format_padded(width, desc, sink, write);
+        }
+    };
+}
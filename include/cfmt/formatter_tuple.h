@@ -0,0 +1,244 @@
+#pragma once
+#include <concepts>
+#include <cstddef>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "strlit.h"
+#include "formatter.h"
+
+namespace cfmt {
+    namespace details {
+        template <class T>
+        concept IsTupleLike = requires {
+            std::tuple_size<T>::value;
+        } && !std::ranges::range<T>;
+
+        /// Converts to any field type but `T` and its bases, to count the fields of an aggregate by initializing it.
+        template <class T>
+        struct AnyField {
+            template <class U>
+                requires (!std::is_base_of_v<U, T>)
+            constexpr operator U() const;
+        };
+        /// Converts only to the bases of `T`: the first initializer of an aggregate is a base if it has one.
+        template <class T>
+        struct AnyBase {
+            template <class U>
+                requires (std::is_base_of_v<U, T> && !std::is_same_v<std::remove_cv_t<U>, T>)
+            constexpr operator U() const;
+        };
+        template <class T>
+        concept HasAggregateBase = requires { T{AnyBase<T>{}}; };
+
+        /// Number of initializers of the aggregate. The braces of an array member are elided,
+        /// so its elements are counted instead of the member.
+        template <class T, class... Fields>
+        constexpr auto aggregate_arity() -> size_t {
+            if constexpr (requires { T{Fields{}..., AnyField<T>{}}; }) {
+                return aggregate_arity<T, Fields..., AnyField<T>>();
+            } else {
+                return sizeof...(Fields);
+            }
+        }
+        inline constexpr size_t max_aggregate_arity = 16;
+
+        template <class T, size_t>
+        using FieldProbe = AnyField<T>;
+        /// True if the initializer after `Before` is a whole member: bracing it keeps the count of initializers.
+        template <class T, size_t... Before, size_t... After>
+        constexpr auto is_whole_field(std::index_sequence<Before...>, std::index_sequence<After...>) -> bool {
+            return requires { T{FieldProbe<T, Before>{}..., {}, FieldProbe<T, After>{}...}; }
+                || requires { T{FieldProbe<T, Before>{}..., {AnyField<T>{}}, FieldProbe<T, After>{}...}; };
+        }
+        /// True if every initializer of the aggregate is a whole member, ie it has no array member of several elements.
+        template <class T, size_t... I>
+        constexpr auto has_whole_fields(std::index_sequence<I...>) -> bool {
+            constexpr auto N = sizeof...(I);
+            return (is_whole_field<T>(std::make_index_sequence<I>{}, std::make_index_sequence<N - I - 1>{}) && ...);
+        }
+
+        /// References to the fields of the aggregate, bound by a structured binding.
+        template <class T>
+        constexpr auto aggregate_fields(const T& value) {
+            constexpr auto N = aggregate_arity<T>();
+            if constexpr (N == 1) {
+                const auto& [f0] = value;
+                return std::tie(f0);
+            } else if constexpr (N == 2) {
+                const auto& [f0, f1] = value;
+                return std::tie(f0, f1);
+            } else if constexpr (N == 3) {
+                const auto& [f0, f1, f2] = value;
+                return std::tie(f0, f1, f2);
+            } else if constexpr (N == 4) {
+                const auto& [f0, f1, f2, f3] = value;
+                return std::tie(f0, f1, f2, f3);
+            } else if constexpr (N == 5) {
+                const auto& [f0, f1, f2, f3, f4] = value;
+                return std::tie(f0, f1, f2, f3, f4);
+            } else if constexpr (N == 6) {
+                const auto& [f0, f1, f2, f3, f4, f5] = value;
+                return std::tie(f0, f1, f2, f3, f4, f5);
+            } else if constexpr (N == 7) {
+                const auto& [f0, f1, f2, f3, f4, f5, f6] = value;
+                return std::tie(f0, f1, f2, f3, f4, f5, f6);
+            } else if constexpr (N == 8) {
+                const auto& [f0, f1, f2, f3, f4, f5, f6, f7] = value;
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7);
+            } else if constexpr (N == 9) {
+                const auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8] = value;
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8);
+            } else if constexpr (N == 10) {
+                const auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9] = value;
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9);
+            } else if constexpr (N == 11) {
+                const auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10] = value;
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10);
+            } else if constexpr (N == 12) {
+                const auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11] = value;
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11);
+            } else if constexpr (N == 13) {
+                const auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12] = value;
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12);
+            } else if constexpr (N == 14) {
+                const auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13] = value;
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13);
+            } else if constexpr (N == 15) {
+                const auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14] = value;
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14);
+            } else if constexpr (N == 16) {
+                const auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15] = value;
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15);
+            }
+        }
+
+        /// Aggregates whose fields can be bound by a structured binding of `aggregate_arity` names:
+        /// the ones with a base or an array member are rejected, their initializers are not their fields.
+        template <class T>
+        concept IsSimpleAggregate = std::is_aggregate_v<T> && std::is_class_v<T>
+            && !std::ranges::range<T> && !IsTupleLike<T>
+            && !std::convertible_to<const T&, std::string_view>
+            && !HasAggregateBase<T>
+            && aggregate_arity<T>() > 0 && aggregate_arity<T>() <= max_aggregate_arity
+            && has_whole_fields<T>(std::make_index_sequence<aggregate_arity<T>()>{});
+
+        template <class Tuple, size_t... I>
+        constexpr auto tuple_elements_formatable(std::index_sequence<I...>) -> bool {
+            return (IsFormatable<std::remove_cvref_t<std::tuple_element_t<I, Tuple>>> && ...);
+        }
+        template <class Tuple>
+        concept IsFormatableTuple = tuple_elements_formatable<Tuple>(std::make_index_sequence<std::tuple_size_v<Tuple>>{});
+
+        /// Writes the fields of the tuple-like value, unrolled at compile time.
+        /// The fields are formatted with their default spec.
+        template <class Tuple, IsSink Sink, size_t... I>
+        constexpr auto format_fields(const Tuple& fields, [[maybe_unused]] std::string_view separator, Sink& sink, std::index_sequence<I...>) -> void {
+            using std::get;
+            [[maybe_unused]] auto no_integer = [](int64_t) { return int64_t(0); };
+            ((I == 0 ? void() : void(sink.append(separator)), format_value(sink, get<I>(fields), std::string_view{}, no_integer)), ...);
+        }
+        template <class Tuple, size_t... I>
+        constexpr auto fields_size(const Tuple& fields, std::index_sequence<I...>) -> size_t {
+            using std::get;
+            return (formatted_size_of(Formatter<std::remove_cvref_t<decltype(get<I>(fields))>>{}, get<I>(fields), FormatDescriptor{}) + ... + 0);
+        }
+
+        /// Formatter of the values whose fields are given by `FieldsFn`: the fields are written
+        /// between brackets and separated by ", ", which the range spec can change (eg "{:|; |[]}").
+        /// Only the fill, the alignment and the width apply to the value as a whole.
+        template <class T, auto FieldsFn, strlit::String DefaultBrackets>
+        struct FieldsFormatter : Formatter<std::string_view> {
+            using Fields = std::remove_cvref_t<decltype(FieldsFn(std::declval<const T&>()))>;
+            static constexpr size_t field_count = std::tuple_size_v<Fields>;
+            static constexpr std::string_view default_separator = ", ";
+            static constexpr std::string_view default_brackets = DefaultBrackets.sv();
+            static constexpr std::string_view presentation_types = "";
+
+            static constexpr auto check_spec(std::string_view spec) -> const char* {
+                FormatDescriptor desc;
+                if (desc.parse(spec.begin(), spec.end()) != spec.end()) {
+                    return "invalid format spec";
+                }
+                if (desc.type || desc.sign != '-' || desc.numb_prefix || desc.zero_pad || desc.precision || desc.precision_arg || desc.localized) {
+                    return "only the fill, the alignment, the width and the range spec apply to tuples";
+                }
+                return nullptr;
+            }
+            template <class DescriptorType, IsSink Sink>
+            constexpr auto format(const T& input, const DescriptorType& desc, Sink& sink) const -> void {
+                if (desc.width == 0) {
+                    write(input, desc, sink);
+                    return;
+                }
+                WidthCountingSink counter;
+                write(input, desc, counter);
+                format_padded(counter.width, desc, sink, [&](auto& out) {
+                    write(input, desc, out);
+                });
+            }
+            template <class DescriptorType>
+            constexpr auto format(const T& input, const DescriptorType& desc) const -> std::string {
+                std::string result;
+                format(input, desc, result);
+                return result;
+            }
+            template <class DescriptorType>
+            constexpr auto size_hint(const T& input, const DescriptorType& desc) const -> size_t {
+                auto separator = separator_of(desc);
+                auto size = brackets_of(desc).size() + (field_count > 1 ? (field_count - 1) * separator.size() : 0)
+                    + fields_size(FieldsFn(input), std::make_index_sequence<field_count>{});
+                if (desc.width == 0) {
+                    return size;
+                }
+                WidthCountingSink counter;
+                write(input, desc, counter);
+                return size + (counter.width < desc.width ? desc.width - counter.width : 0);
+            }
+        private:
+            template <class DescriptorType>
+            static constexpr auto separator_of(const DescriptorType& desc) -> std::string_view {
+                if constexpr (requires { desc.separator; }) {
+                    return desc.separator.value_or(default_separator);
+                } else {
+                    return default_separator;
+                }
+            }
+            template <class DescriptorType>
+            static constexpr auto brackets_of(const DescriptorType& desc) -> std::string_view {
+                if constexpr (requires { desc.brackets; }) {
+                    return desc.brackets.value_or(default_brackets);
+                } else {
+                    return default_brackets;
+                }
+            }
+            template <class DescriptorType, IsSink Sink>
+            static constexpr auto write(const T& input, const DescriptorType& desc, Sink& sink) -> void {
+                auto brackets = brackets_of(desc);
+                sink.append(brackets.substr(0, brackets.size()/2));
+                format_fields(FieldsFn(input), separator_of(desc), sink, std::make_index_sequence<field_count>{});
+                sink.append(brackets.substr(brackets.size()/2));
+            }
+        };
+        inline constexpr auto tuple_fields = [](const auto& value) -> const auto& {
+            return value;
+        };
+        inline constexpr auto struct_fields = [](const auto& value) {
+            return aggregate_fields(value);
+        };
+    }
+
+    /// Tuple-like types, eg `std::tuple` and `std::pair`: "(1, abc, 2.5)".
+    template <details::IsTupleLike T>
+        requires details::IsFormatableTuple<T>
+    struct Formatter<T> : details::FieldsFormatter<T, details::tuple_fields, "()"> {};
+
+    /// Aggregates of up to 16 fields without base classes, eg `struct Point { int x; int y; }`: "{1, 2}".
+    /// The fields are counted by initializing the aggregate, so arrays of fields are counted item by item.
+    template <details::IsSimpleAggregate T>
+        requires details::IsFormatableTuple<decltype(details::aggregate_fields(std::declval<const T&>()))>
+    struct Formatter<T> : details::FieldsFormatter<T, details::struct_fields, "{}"> {};
+}
@@ -0,0 +1,346 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include "sink.h"
+#if defined(CFMT_INSTRUMENT)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "digits.h"
+#endif
+
+/// Define CFMT_INSTRUMENT in every translation unit to record the cost of every format string:
+/// calls, bytes written, fields formatted, allocations and time, read with `cfmt::instrument::snapshot()`.
+/// Without it the hooks are empty and nothing is recorded.
+namespace cfmt::details {
+    /// Key of a format string in the statistics, FNV-1a hash of its text.
+    constexpr auto format_key(std::string_view text) -> uint64_t {
+        uint64_t hash = 0xcbf29ce484222325;
+        for (auto ch : text) {
+            hash = (hash ^ static_cast<uint8_t>(ch)) * 0x100000001b3;
+        }
+        return hash;
+    }
+}
+
+#if defined(CFMT_INSTRUMENT)
+namespace cfmt::instrument {
+    /// Statistics of a format string since the start of the program or the last `reset()`.
+    struct FormatStats {
+        std::string format;
+        uint64_t calls = 0;
+        /// characters written to the sinks
+        uint64_t bytes = 0;
+        /// fields formatted, nested ones included (eg the items of a tuple)
+        uint64_t fields = 0;
+        /// allocations counted by `count_allocation()`
+        uint64_t allocations = 0;
+        std::chrono::nanoseconds time{};
+    };
+
+    /// Counts an allocation of the current thread. Called by the `operator new` defined with CFMT_INSTRUMENT_NEW,
+    /// or by the replacement `operator new` of the program.
+    inline auto count_allocation() noexcept -> void;
+}
+
+namespace cfmt::details {
+    inline constexpr bool use_instrumentation = true;
+
+    /// Counters of a format string on one thread. The thread is their only writer,
+    /// so it adds to them without read-modify-write instructions.
+    struct FormatCounters {
+        std::atomic<uint64_t> calls = 0;
+        std::atomic<uint64_t> bytes = 0;
+        std::atomic<uint64_t> fields = 0;
+        std::atomic<uint64_t> allocations = 0;
+        std::atomic<uint64_t> nanoseconds = 0;
+
+        static auto add(std::atomic<uint64_t>& counter, uint64_t value) -> void {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+    };
+    struct FormatTotals {
+        uint64_t calls = 0;
+        uint64_t bytes = 0;
+        uint64_t fields = 0;
+        uint64_t allocations = 0;
+        uint64_t nanoseconds = 0;
+
+        auto add(const FormatCounters& counters) -> void {
+            calls += counters.calls.load(std::memory_order_relaxed);
+            bytes += counters.bytes.load(std::memory_order_relaxed);
+            fields += counters.fields.load(std::memory_order_relaxed);
+            allocations += counters.allocations.load(std::memory_order_relaxed);
+            nanoseconds += counters.nanoseconds.load(std::memory_order_relaxed);
+        }
+    };
+    struct ThreadCounters;
+    struct FormatRegistry {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, std::string> formats;
+        std::vector<ThreadCounters*> threads;
+        /// totals of the exited threads
+        std::unordered_map<uint64_t, FormatTotals> exited;
+        /// totals at the last reset
+        std::unordered_map<uint64_t, FormatTotals> baseline;
+    };
+    inline auto format_registry() -> FormatRegistry& {
+        static FormatRegistry registry;
+        return registry;
+    }
+    /// Counters of the current thread, registered for the snapshots. The format strings new to the thread
+    /// are added under the mutex of the registry, the others are found without locking.
+    struct ThreadCounters {
+        std::unordered_map<uint64_t, FormatCounters> counters;
+        uint64_t last_key = 0;
+        FormatCounters* last = nullptr;
+
+        ThreadCounters() {
+            auto& registry = format_registry();
+            std::lock_guard lock(registry.mutex);
+            registry.threads.push_back(this);
+        }
+        ThreadCounters(const ThreadCounters&) = delete;
+        auto operator=(const ThreadCounters&) -> ThreadCounters& = delete;
+        ~ThreadCounters() {
+            auto& registry = format_registry();
+            std::lock_guard lock(registry.mutex);
+            for (const auto& [key, format_counters] : counters) {
+                registry.exited[key].add(format_counters);
+            }
+            std::erase(registry.threads, this);
+        }
+        auto get(uint64_t key, std::string_view text) -> FormatCounters& {
+            if (last != nullptr && last_key == key) {
+                return *last;
+            }
+            auto it = counters.find(key);
+            if (it == counters.end()) {
+                auto& registry = format_registry();
+                std::lock_guard lock(registry.mutex);
+                registry.formats.try_emplace(key, text);
+                it = counters.try_emplace(key).first;
+            }
+            last_key = key;
+            last = &it->second;
+            return *last;
+        }
+    };
+    inline auto format_counters(uint64_t key, std::string_view text) -> FormatCounters& {
+        thread_local ThreadCounters thread_counters;
+        return thread_counters.get(key, text);
+    }
+    /// Totals of every format string since the start of the program. The mutex of the registry must be locked.
+    inline auto format_totals(FormatRegistry& registry) -> std::unordered_map<uint64_t, FormatTotals> {
+        auto totals = registry.exited;
+        for (auto thread : registry.threads) {
+            for (const auto& [key, format_counters] : thread->counters) {
+                totals[key].add(format_counters);
+            }
+        }
+        return totals;
+    }
+
+    inline thread_local uint64_t allocation_count = 0;
+
+    /// Format call in progress on the current thread.
+    struct FormatScope {
+        using clock = std::chrono::steady_clock;
+        FormatCounters& counters;
+        FormatScope* previous;
+        uint64_t fields = 0;
+        uint64_t allocations = allocation_count;
+        clock::time_point start = clock::now();
+
+        static auto current() -> FormatScope*& {
+            thread_local FormatScope* scope = nullptr;
+            return scope;
+        }
+        explicit FormatScope(FormatCounters& format_counters)
+            : counters(format_counters)
+            , previous(std::exchange(current(), this))
+        {}
+        FormatScope(const FormatScope&) = delete;
+        auto operator=(const FormatScope&) -> FormatScope& = delete;
+        ~FormatScope() {
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+            FormatCounters::add(counters.calls, 1);
+            FormatCounters::add(counters.fields, fields);
+            FormatCounters::add(counters.allocations, allocation_count - allocations);
+            FormatCounters::add(counters.nanoseconds, static_cast<uint64_t>(elapsed.count()));
+            current() = previous;
+        }
+    };
+
+    /// Sink counting the characters written to the sink of a format call.
+    template <IsSink Sink>
+    struct InstrumentedSink {
+        Sink& sink;
+        size_t size = 0;
+        constexpr auto append(std::string_view str) -> InstrumentedSink& {
+            sink.append(str);
+            size += str.size();
+            return *this;
+        }
+        constexpr auto append(size_t count, char ch) -> InstrumentedSink& {
+            sink.append(count, ch);
+            size += count;
+            return *this;
+        }
+        constexpr auto reserve(size_t count) -> void {
+            details::reserve(sink, count);
+        }
+        constexpr auto append_buffer(size_t count) -> char* {
+            auto buffer = details::append_buffer(sink, count);
+            if (buffer != nullptr) {
+                size += count;
+            }
+            return buffer;
+        }
+    };
+
+    template <IsSink Sink, class Fn>
+    auto record_format(Sink& sink, std::string_view text, uint64_t key, Fn&& fn) -> void {
+        auto& counters = format_counters(key, text);
+        FormatScope scope(counters);
+        InstrumentedSink<Sink> counted{sink};
+        fn(counted);
+        FormatCounters::add(counters.bytes, counted.size);
+    }
+    /// Calls `fn(sink)` for a call with the format string, and records it under `key`.
+    template <IsSink Sink, class Fn>
+    constexpr auto instrumented(Sink& sink, std::string_view text, uint64_t key, Fn&& fn) -> void {
+        if (std::is_constant_evaluated()) {
+            fn(sink);
+        } else {
+            record_format(sink, text, key, fn);
+        }
+    }
+    template <IsSink Sink, class Fn>
+    constexpr auto instrumented(Sink& sink, std::string_view text, Fn&& fn) -> void {
+        if (std::is_constant_evaluated()) {
+            fn(sink);
+        } else {
+            record_format(sink, text, format_key(text), fn);
+        }
+    }
+    inline auto record_field() -> void {
+        if (auto scope = FormatScope::current()) {
+            ++scope->fields;
+        }
+    }
+    /// Called for every field formatted.
+    constexpr auto instrument_field() -> void {
+        if (!std::is_constant_evaluated()) {
+            record_field();
+        }
+    }
+}
+
+namespace cfmt::instrument {
+    inline auto count_allocation() noexcept -> void {
+        ++details::allocation_count;
+    }
+
+    /// Statistics of every format string used so far, the most expensive first.
+    inline auto snapshot() -> std::vector<FormatStats> {
+        auto& registry = details::format_registry();
+        std::vector<FormatStats> result;
+        {
+            std::lock_guard lock(registry.mutex);
+            auto totals = details::format_totals(registry);
+            result.reserve(totals.size());
+            for (const auto& [key, total] : totals) {
+                auto baseline = registry.baseline[key];
+                auto& stats = result.emplace_back();
+                stats.format = registry.formats[key];
+                stats.calls = total.calls - baseline.calls;
+                stats.bytes = total.bytes - baseline.bytes;
+                stats.fields = total.fields - baseline.fields;
+                stats.allocations = total.allocations - baseline.allocations;
+                stats.time = std::chrono::nanoseconds(total.nanoseconds - baseline.nanoseconds);
+            }
+        }
+        std::sort(result.begin(), result.end(), [](const FormatStats& lhs, const FormatStats& rhs) {
+            return lhs.time > rhs.time;
+        });
+        return result;
+    }
+    /// Sets the statistics of every format string to zero.
+    inline auto reset() -> void {
+        auto& registry = details::format_registry();
+        std::lock_guard lock(registry.mutex);
+        registry.baseline = details::format_totals(registry);
+    }
+    /// Writes the statistics to the sink, one format string per line:
+    /// `calls bytes fields allocations nanoseconds "format"`, with the control characters of the format escaped.
+    template <IsSink Sink>
+    auto dump(Sink& sink, const std::vector<FormatStats>& stats = snapshot()) -> void {
+        char buffer[20];
+        auto write_number = [&](uint64_t value) {
+            sink.append(std::string_view(buffer, details::write_decimal(buffer, value)));
+            sink.append(1, ' ');
+        };
+        for (const auto& format_stats : stats) {
+            write_number(format_stats.calls);
+            write_number(format_stats.bytes);
+            write_number(format_stats.fields);
+            write_number(format_stats.allocations);
+            write_number(static_cast<uint64_t>(format_stats.time.count()));
+            sink.append(1, '"');
+            for (auto ch : format_stats.format) {
+                switch (ch) {
+                    case '\n': sink.append("\\n"); break;
+                    case '\t': sink.append("\\t"); break;
+                    case '\r': sink.append("\\r"); break;
+                    case '"': sink.append("\\\""); break;
+                    case '\\': sink.append("\\\\"); break;
+                    default: sink.append(1, ch); break;
+                }
+            }
+            sink.append("\"\n");
+        }
+    }
+}
+
+#if defined(CFMT_INSTRUMENT_NEW)
+/// Define CFMT_INSTRUMENT_NEW in one translation unit to count the allocations with these `operator new`.
+auto operator new(std::size_t size) -> void* {
+    cfmt::instrument::count_allocation();
+    if (auto ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+auto operator delete(void* ptr) noexcept -> void {
+    std::free(ptr);
+}
+auto operator delete(void* ptr, std::size_t) noexcept -> void {
+    std::free(ptr);
+}
+#endif
+
+#else
+namespace cfmt::details {
+    inline constexpr bool use_instrumentation = false;
+
+    template <IsSink Sink, class Fn>
+    constexpr auto instrumented(Sink& sink, std::string_view, uint64_t, Fn&& fn) -> void {
+        fn(sink);
+    }
+    template <IsSink Sink, class Fn>
+    constexpr auto instrumented(Sink& sink, std::string_view, Fn&& fn) -> void {
+        fn(sink);
+    }
+    constexpr auto instrument_field() -> void {}
+}
+#endif
@@ -0,0 +1,134 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <climits>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <locale>
+#include <mutex>
+#include <string>
+#include "digits.h"
+
+namespace cfmt
+{
+    /// Digit grouping of the numbers formatted with the 'L' option.
+    /// `sizes` are the sizes of the groups from the rightmost digit, ending with 0.
+    /// The last size is repeated if `repeat_last`, like the grouping of `std::numpunct`.
+    struct DigitGrouping {
+        char separator = ',';
+        char decimal_point = '.';
+        std::array<uint8_t, 8> sizes = {};
+        bool repeat_last = true;
+
+        /// Groups of `size` digits, eg `uniform(',', 3)` for "1,234,567".
+        static constexpr auto uniform(char separator, uint8_t size, char decimal_point = '.') -> DigitGrouping {
+            return {separator, decimal_point, {size}, true};
+        }
+        /// Grouping of the numpunct facet of the locale, read once.
+        static auto from_locale(const std::locale& locale) -> DigitGrouping {
+            const auto& facet = std::use_facet<std::numpunct<char>>(locale);
+            DigitGrouping result;
+            result.separator = facet.thousands_sep();
+            result.decimal_point = facet.decimal_point();
+            auto grouping = facet.grouping();
+            size_t count = 0;
+            for (auto size : grouping) {
+                if (size <= 0 || size == CHAR_MAX || count + 1 == result.sizes.size()) {
+                    result.repeat_last = false;
+                    break;
+                }
+                result.sizes[count++] = static_cast<uint8_t>(size);
+            }
+            return result;
+        }
+
+        constexpr auto is_grouped() const -> bool {
+            return sizes[0] != 0;
+        }
+        /// Number of separators between `digits` digits.
+        constexpr auto separator_count(size_t digits) const -> size_t {
+            size_t count = 0;
+            size_t i = 0;
+            auto size = static_cast<size_t>(sizes[0]);
+            while (size != 0 && digits > size) {
+                digits -= size;
+                ++count;
+                if (i + 1 < sizes.size() && sizes[i+1] != 0) {
+                    size = sizes[++i];
+                } else if (!repeat_last) {
+                    break;
+                }
+            }
+            return count;
+        }
+    };
+
+    namespace details {
+        inline auto digit_grouping_slot() -> std::atomic<const DigitGrouping*>& {
+            static std::atomic<const DigitGrouping*> slot = nullptr;
+            return slot;
+        }
+
+        /// Writes the decimal digits with the separators of the grouping at `begin` and returns the end.
+        /// Groups of 3 digits are written with the digit pairs, 3 digits at a time.
+        template <std::unsigned_integral U>
+        constexpr auto write_decimal_grouped(char* begin, U value, const DigitGrouping& grouping) -> char* {
+            auto digits = count_digits(value);
+            auto end = begin + digits + grouping.separator_count(digits);
+            auto it = end;
+            if (grouping.sizes[0] == 3 && grouping.sizes[1] == 0 && grouping.repeat_last) {
+                while (value >= 1000) {
+                    auto group = static_cast<size_t>(value % 1000);
+                    value /= 1000;
+                    auto pair = (group % 100) * 2;
+                    *--it = digit_pairs[pair+1];
+                    *--it = digit_pairs[pair];
+                    *--it = static_cast<char>('0' + group / 100);
+                    *--it = grouping.separator;
+                }
+                write_decimal(begin, value);
+                return end;
+            }
+            size_t i = 0;
+            auto size = static_cast<size_t>(grouping.sizes[0]);
+            size_t in_group = 0;
+            do {
+                if (size != 0 && in_group == size) {
+                    *--it = grouping.separator;
+                    in_group = 0;
+                    if (i + 1 < grouping.sizes.size() && grouping.sizes[i+1] != 0) {
+                        size = grouping.sizes[++i];
+                    } else if (!grouping.repeat_last) {
+                        size = 0;
+                    }
+                }
+                *--it = static_cast<char>('0' + value % 10);
+                value /= 10;
+                ++in_group;
+            } while (value != 0);
+            return end;
+        }
+    }
+
+    /// Grouping used by the 'L' option: the grouping of the global locale, read on the first use,
+    /// or the last one given to `set_digit_grouping`. Formatting with 'L' at compile time fails the build.
+    inline auto digit_grouping() -> const DigitGrouping& {
+        if (auto grouping = details::digit_grouping_slot().load(std::memory_order_acquire)) {
+            return *grouping;
+        }
+        static const DigitGrouping global = DigitGrouping::from_locale(std::locale());
+        return global;
+    }
+    /// Sets the grouping used by the 'L' option, eg `DigitGrouping::uniform(',', 3)` or
+    /// `DigitGrouping::from_locale(std::locale("de_DE.UTF-8"))`.
+    inline auto set_digit_grouping(const DigitGrouping& grouping) -> void {
+        // the previous groupings are kept, other threads may still be formatting with them
+        static std::mutex mutex;
+        static std::deque<DigitGrouping> groupings;
+        std::lock_guard lock(mutex);
+        groupings.push_back(grouping);
+        details::digit_grouping_slot().store(&groupings.back(), std::memory_order_release);
+    }
+}
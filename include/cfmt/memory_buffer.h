@@ -0,0 +1,172 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "format.h"
+
+namespace cfmt
+{
+    /// Sink storing up to `InlineN` characters in itself, and the longer texts in memory given by `Alloc`.
+    template <size_t InlineN = 500, class Alloc = std::allocator<char>>
+    class memory_buffer {
+    public:
+        using allocator_type = Alloc;
+
+        memory_buffer() = default;
+        explicit memory_buffer(const Alloc& alloc) : m_alloc(alloc) {}
+        memory_buffer(memory_buffer&& other) noexcept : m_alloc(other.m_alloc) {
+            take(other);
+        }
+        auto operator=(memory_buffer&& other) noexcept -> memory_buffer& {
+            if (this == &other) {
+                return *this;
+            }
+            if constexpr (Traits::propagate_on_container_move_assignment::value) {
+                deallocate();
+                m_alloc = std::move(other.m_alloc);
+                take(other);
+            } else if (m_alloc == other.m_alloc) {
+                deallocate();
+                take(other);
+            } else {
+                // the memory of `other` can not be released by this allocator
+                clear();
+                append(other.sv());
+                other.clear();
+            }
+            return *this;
+        }
+        memory_buffer(const memory_buffer&) = delete;
+        auto operator=(const memory_buffer&) -> memory_buffer& = delete;
+        ~memory_buffer() {
+            deallocate();
+        }
+
+        auto append(std::string_view str) -> memory_buffer& {
+            reserve(m_size + str.size());
+            std::copy(str.begin(), str.end(), m_data + m_size);
+            m_size += str.size();
+            return *this;
+        }
+        auto append(size_t count, char ch) -> memory_buffer& {
+            reserve(m_size + count);
+            std::fill_n(m_data + m_size, count, ch);
+            m_size += count;
+            return *this;
+        }
+        /// Appends `count` uninitialized characters and returns them.
+        auto append_buffer(size_t count) -> char* {
+            reserve(m_size + count);
+            auto buffer = m_data + m_size;
+            m_size += count;
+            return buffer;
+        }
+        /// Makes room for `capacity` characters in total.
+        auto reserve(size_t capacity) -> void {
+            if (capacity > m_capacity) {
+                grow(capacity);
+            }
+        }
+        auto clear() -> void {
+            m_size = 0;
+        }
+
+        auto size() const -> size_t {
+            return m_size;
+        }
+        auto capacity() const -> size_t {
+            return m_capacity;
+        }
+        auto data() const -> const char* {
+            return m_data;
+        }
+        auto sv() const -> std::string_view {
+            return std::string_view(m_data, m_size);
+        }
+        auto get_allocator() const -> Alloc {
+            return m_alloc;
+        }
+    private:
+        using Traits = std::allocator_traits<Alloc>;
+
+        auto is_inline() const -> bool {
+            return m_data == m_inline;
+        }
+        auto grow(size_t min_capacity) -> void {
+            auto capacity = std::max(min_capacity, m_capacity + m_capacity/2);
+            auto data = Traits::allocate(m_alloc, capacity);
+            std::copy_n(m_data, m_size, data);
+            deallocate();
+            m_data = data;
+            m_capacity = capacity;
+        }
+        auto deallocate() -> void {
+            if (!is_inline()) {
+                Traits::deallocate(m_alloc, m_data, m_capacity);
+            }
+        }
+        /// Takes the text of `other`, which is left empty.
+        auto take(memory_buffer& other) -> void {
+            if (other.is_inline()) {
+                std::copy_n(other.m_inline, other.m_size, m_inline);
+                m_data = m_inline;
+                m_capacity = InlineN;
+            } else {
+                m_data = other.m_data;
+                m_capacity = other.m_capacity;
+            }
+            m_size = other.m_size;
+            other.m_data = other.m_inline;
+            other.m_size = 0;
+            other.m_capacity = InlineN;
+        }
+
+        [[no_unique_address]] Alloc m_alloc;
+        char* m_data = m_inline;
+        size_t m_size = 0;
+        size_t m_capacity = InlineN;
+        char m_inline[InlineN];
+    };
+
+    template <class Alloc>
+    concept IsCharAllocator = requires(Alloc alloc, size_t count) {
+        { alloc.allocate(count) } -> std::same_as<char*>;
+    };
+
+    /// Formats into a string using the allocator.
+    template <IsCharAllocator Alloc, details::IsFormatText FormatT>
+    auto format_runtime(const Alloc& alloc, const FormatT& format_text, const auto&... args)
+        -> std::basic_string<char, std::char_traits<char>, Alloc>
+    {
+        std::basic_string<char, std::char_traits<char>, Alloc> result(alloc);
+        details::vformat_to(result, format_text, args...);
+        return result;
+    }
+    template <IsCharAllocator Alloc, class... Args>
+    auto format_runtime(const Alloc& alloc, format_string<Args...> format_text, const Args&... args)
+        -> std::basic_string<char, std::char_traits<char>, Alloc>
+    {
+        std::basic_string<char, std::char_traits<char>, Alloc> result(alloc);
+        details::vformat_to(result, format_text, args...);
+        return result;
+    }
+
+    namespace pmr {
+        template <size_t InlineN = 500>
+        using memory_buffer = cfmt::memory_buffer<InlineN, std::pmr::polymorphic_allocator<char>>;
+
+        /// Formats into a string allocated from the memory resource, eg a `std::pmr::monotonic_buffer_resource`.
+        template <details::IsFormatText FormatT>
+        auto format_runtime(std::pmr::memory_resource* resource, const FormatT& format_text, const auto&... args) -> std::pmr::string {
+            return cfmt::format_runtime(std::pmr::polymorphic_allocator<char>(resource), format_text, args...);
+        }
+        template <class... Args>
+        auto format_runtime(std::pmr::memory_resource* resource, format_string<Args...> format_text, const Args&... args) -> std::pmr::string {
+            return cfmt::format_runtime(std::pmr::polymorphic_allocator<char>(resource), format_text, args...);
+        }
+    }
+}
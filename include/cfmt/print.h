@@ -0,0 +1,228 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <type_traits>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#include "format.h"
+
+namespace cfmt
+{
+    namespace details {
+        /// Writes the whole text to the file descriptor, retrying on partial writes and interruptions.
+        inline auto write_all(int fd, std::string_view text) -> void {
+            while (!text.empty()) {
+#if defined(_WIN32)
+                auto written = ::_write(fd, text.data(), static_cast<unsigned>(std::min<size_t>(text.size(), 1u << 30)));
+#else
+                auto written = ::write(fd, text.data(), text.size());
+#endif
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return;
+                }
+                text.remove_prefix(static_cast<size_t>(written));
+            }
+        }
+        /// Writes both texts with a single system call when possible.
+        inline auto write_all(int fd, std::string_view first, std::string_view second) -> void {
+#if defined(_WIN32)
+            write_all(fd, first);
+            write_all(fd, second);
+#else
+            while (!first.empty()) {
+                iovec parts[2] = {
+                    {const_cast<char*>(first.data()), first.size()},
+                    {const_cast<char*>(second.data()), second.size()},
+                };
+                auto written = ::writev(fd, parts, 2);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return;
+                }
+                auto written_first = std::min(static_cast<size_t>(written), first.size());
+                first.remove_prefix(written_first);
+                second.remove_prefix(static_cast<size_t>(written) - written_first);
+            }
+            write_all(fd, second);
+#endif
+        }
+
+        /// Destination of the prints: a file descriptor, or a `FILE*` to keep the order with the stdio functions.
+        struct PrintTarget {
+            std::FILE* file = nullptr;
+            int fd = -1;
+            constexpr auto operator==(const PrintTarget&) const -> bool = default;
+        };
+
+        /// Per-thread sink of the prints. The text is flushed when the buffer is full and at the end
+        /// of each print, or at the end of the outermost batch.
+        class PrintBuffer {
+        public:
+            static constexpr size_t capacity = 4096;
+
+            PrintBuffer() = default;
+            PrintBuffer(const PrintBuffer&) = delete;
+            auto operator=(const PrintBuffer&) -> PrintBuffer& = delete;
+            ~PrintBuffer() {
+                flush();
+            }
+
+            auto append(std::string_view str) -> PrintBuffer& {
+                if (str.size() <= capacity - m_size) {
+                    std::copy(str.begin(), str.end(), m_data.data() + m_size);
+                    m_size += str.size();
+                } else if (str.size() < capacity) {
+                    flush();
+                    append(str);
+                } else {
+                    // large texts are written directly, along with the buffered text
+                    write(buffered(), str);
+                    m_size = 0;
+                    m_print_start = 0;
+                }
+                return *this;
+            }
+            auto append(size_t count, char ch) -> PrintBuffer& {
+                while (count > 0) {
+                    if (m_size == capacity) {
+                        flush();
+                    }
+                    auto fill_count = std::min(count, capacity - m_size);
+                    std::fill_n(m_data.data() + m_size, fill_count, ch);
+                    m_size += fill_count;
+                    count -= fill_count;
+                }
+                return *this;
+            }
+            /// Changes the destination, flushing the text written to the previous one.
+            auto set_target(PrintTarget target) -> void {
+                if (target != m_target) {
+                    flush();
+                    m_target = target;
+                }
+            }
+            auto flush() -> void {
+                if (m_size != 0) {
+                    write(buffered(), {});
+                    m_size = 0;
+                    m_print_start = 0;
+                }
+            }
+            /// Marks the start of the text of a print, to drop it with `cancel_print` if the formatting fails.
+            auto begin_print() -> void {
+                m_print_start = m_size;
+            }
+            /// Drops the text of the print written since `begin_print`, except what was already flushed.
+            auto cancel_print() -> void {
+                m_size = m_print_start;
+            }
+            auto begin_batch() -> void {
+                ++m_batch_depth;
+            }
+            auto end_batch() -> void {
+                if (--m_batch_depth == 0) {
+                    flush();
+                }
+            }
+            auto batching() const -> bool {
+                return m_batch_depth != 0;
+            }
+        private:
+            auto buffered() const -> std::string_view {
+                return std::string_view(m_data.data(), m_size);
+            }
+            auto write(std::string_view first, std::string_view second) -> void {
+                if (m_target.file != nullptr) {
+                    std::fwrite(first.data(), 1, first.size(), m_target.file);
+                    std::fwrite(second.data(), 1, second.size(), m_target.file);
+                } else if (second.empty()) {
+                    write_all(m_target.fd, first);
+                } else {
+                    write_all(m_target.fd, first, second);
+                }
+            }
+            std::array<char, capacity> m_data;
+            size_t m_size = 0;
+            size_t m_print_start = 0;
+            PrintTarget m_target;
+            uint32_t m_batch_depth = 0;
+        };
+        inline auto print_buffer() -> PrintBuffer& {
+            thread_local PrintBuffer buffer;
+            return buffer;
+        }
+
+        template <class FormatT>
+        auto vprint(PrintTarget target, const FormatT& format_text, const auto&... args) -> void {
+            auto& buffer = print_buffer();
+            buffer.set_target(target);
+            buffer.begin_print();
+            try {
+                vformat_to(buffer, format_text, args...);
+            } catch (...) {
+                buffer.cancel_print();
+                throw;
+            }
+            if (!buffer.batching()) {
+                buffer.flush();
+            }
+        }
+    }
+
+    /// Formats to the stream. The stdio buffer of the stream is used as is, so the output keeps
+    /// its order with the other stdio functions.
+    template <details::IsFormatText FormatT>
+    auto print(std::FILE* file, const FormatT& format_text, const auto&... args) -> void {
+        details::vprint({file, -1}, format_text, args...);
+    }
+    template <class... Args>
+    auto print(std::FILE* file, format_string<Args...> format_text, const Args&... args) -> void {
+        details::vprint({file, -1}, format_text, args...);
+    }
+    /// Formats to the file descriptor, with one system call per print, or per batch.
+    template <details::IsFormatText FormatT>
+    auto print(int fd, const FormatT& format_text, const auto&... args) -> void {
+        details::vprint({nullptr, fd}, format_text, args...);
+    }
+    template <class... Args>
+    auto print(int fd, format_string<Args...> format_text, const Args&... args) -> void {
+        details::vprint({nullptr, fd}, format_text, args...);
+    }
+    /// Formats to stdout.
+    template <details::IsFormatText FormatT>
+    auto print(const FormatT& format_text, const auto&... args) -> void {
+        details::vprint({stdout, -1}, format_text, args...);
+    }
+    template <class... Args>
+    auto print(format_string<Args...> format_text, const Args&... args) -> void {
+        details::vprint({stdout, -1}, format_text, args...);
+    }
+
+    /// While alive, the prints of the current thread are gathered in its buffer and written together,
+    /// when the buffer is full or when the outermost batch ends.
+    class PrintBatch {
+    public:
+        PrintBatch() {
+            details::print_buffer().begin_batch();
+        }
+        PrintBatch(const PrintBatch&) = delete;
+        auto operator=(const PrintBatch&) -> PrintBatch& = delete;
+        ~PrintBatch() {
+            details::print_buffer().end_batch();
+        }
+    };
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+
+namespace cfmt
+{
+    /// Destination of the formatters. `std::string` is a sink.
+    template <class T>
+    concept IsSink = requires(T& sink, std::string_view str, size_t count, char ch) {
+        sink.append(str);
+        sink.append(count, ch);
+    };
+
+    namespace details {
+        /// Reserves room for `count` more characters if the sink supports it.
+        /// Sinks with a `size()` reserve their total size, like `std::string`, others the additional count.
+        template <IsSink Sink>
+        constexpr auto reserve(Sink& sink, size_t count) -> void {
+            if constexpr (requires { sink.reserve(count); sink.size(); }) {
+                sink.reserve(sink.size() + count);
+            } else if constexpr (requires { sink.reserve(count); }) {
+                sink.reserve(count);
+            }
+        }
+        /// Appends `count` characters to the sink and returns them, to be written in place,
+        /// or returns nullptr if the sink does not support it.
+        /// Sinks with an `append_buffer(count)` provide it, and sinks resizable like `std::string`.
+        template <IsSink Sink>
+        constexpr auto append_buffer(Sink& sink, size_t count) -> char* {
+            if constexpr (requires { { sink.append_buffer(count) } -> std::same_as<char*>; }) {
+                return sink.append_buffer(count);
+            } else if constexpr (requires { sink.resize(count); sink.size(); { sink.data() } -> std::same_as<char*>; }) {
+                auto size = sink.size();
+                sink.resize(size + count);
+                return sink.data() + size;
+            } else {
+                return nullptr;
+            }
+        }
+    }
+
+    /// Sink writing to an output iterator.
+    template <class OutputIt>
+    struct IteratorSink {
+        OutputIt out;
+        constexpr auto append(std::string_view str) -> IteratorSink& {
+            out = std::copy(str.begin(), str.end(), out);
+            return *this;
+        }
+        constexpr auto append(size_t count, char ch) -> IteratorSink& {
+            out = std::fill_n(out, count, ch);
+            return *this;
+        }
+    };
+
+    /// Sink writing at most `limit` characters to an output iterator.
+    /// `size` holds the size of the whole output, including the discarded characters.
+    template <class OutputIt>
+    struct TruncatingSink {
+        OutputIt out;
+        size_t limit;
+        size_t size = 0;
+        constexpr auto append(std::string_view str) -> TruncatingSink& {
+            auto count = std::min(str.length(), remaining());
+            out = std::copy_n(str.begin(), count, out);
+            size += str.length();
+            return *this;
+        }
+        constexpr auto append(size_t count, char ch) -> TruncatingSink& {
+            out = std::fill_n(out, std::min(count, remaining()), ch);
+            size += count;
+            return *this;
+        }
+        constexpr auto remaining() const -> size_t {
+            return size < limit ? limit - size : 0;
+        }
+    };
+
+    /// Sink only counting the characters written to it.
+    struct CountingSink {
+        size_t size = 0;
+        constexpr auto append(std::string_view str) -> CountingSink& {
+            size += str.length();
+            return *this;
+        }
+        constexpr auto append(size_t count, char) -> CountingSink& {
+            size += count;
+            return *this;
+        }
+    };
+}
@@ -3,6 +3,7 @@
 #include <concepts>
 #include <cstddef>
 #include <array>
+#include <initializer_list>
 #include <string_view>
 #include <type_traits>
 
@@ -19,14 +20,22 @@ namespace strlit {
             constexpr auto sv() const -> std::string_view {
                 return std::string_view(text, size);
             }
+            /// Length up to the first '\0', or the size if there is none.
             constexpr auto length() const -> size_t {
-                size_t i = 0;
-                while (text[i++] && i < N);
-                return i-1;
+                return text_length;
             }
             static constexpr size_t SIZE = N;
             size_t size = N;
+            /// Length up to the first '\0', found once by the constructors which may write one in the text
+            size_t text_length = N;
             char text[N+1];
+        protected:
+            constexpr auto update_length() -> void {
+                text_length = 0;
+                while (text_length < size && text[text_length] != '\0') {
+                    ++text_length;
+                }
+            }
         };
         constexpr size_t string_length(const char* str) {
             auto begin = str;
@@ -34,13 +43,29 @@ namespace strlit {
             return str-begin;
         }
         constexpr size_t string_length(std::string_view str) {
-            const auto begin = std::begin(str);
-            const auto end = std::end(str);
-            auto it = begin;
-            while (it != end && *it) {
-                ++it;
+            return std::min(str.find('\0'), str.size());
+        }
+        /// Size of the texts joined with a separator of `separator_size`.
+        /// The sizes are taken as a list rather than a fold expression, so thousands of strings
+        /// do not hit the bracket depth or the template recursion limits.
+        constexpr size_t joined_size(std::initializer_list<size_t> sizes, size_t separator_size) {
+            size_t size = 0;
+            for (auto part : sizes) {
+                size += part;
+            }
+            return sizes.size() == 0 ? 0 : size + (sizes.size() - 1) * separator_size;
+        }
+        /// Copies the texts one after another with `separator` between them, and returns the end.
+        constexpr char* join_to(char* out, std::string_view separator, std::initializer_list<std::string_view> parts) {
+            auto first = true;
+            for (auto part : parts) {
+                if (!first) {
+                    out = std::copy(separator.begin(), separator.end(), out);
+                }
+                out = std::copy(part.begin(), part.end(), out);
+                first = false;
             }
-            return std::distance(begin, it);
+            return out;
         }
     }
 
@@ -50,9 +75,11 @@ namespace strlit {
         {}
         constexpr String(const char (&str)[N]) : details::BaseString<N-1>() {
             std::copy_n(str, N-1, this->text);
+            this->update_length();
         }
         constexpr String(const String<N>& other) : details::BaseString<N-1>() {
             std::copy_n(other.text, N-1, this->text);
+            this->text_length = other.text_length;
         }
     };
     
@@ -81,27 +108,17 @@ namespace strlit {
 
 
     template <StringType... strings>
-    struct Concat : details::BaseString<(decltype(strings)::SIZE + ...)> {
-        constexpr Concat() : details::BaseString<(strings.size + ...)>() {
-            size_t offset = 0;
-            ((std::copy_n(strings.text, strings.size, this->text + offset), offset += strings.size), ...);
+    struct Concat : details::BaseString<details::joined_size({decltype(strings)::SIZE...}, 0)> {
+        constexpr Concat() : details::BaseString<details::joined_size({decltype(strings)::SIZE...}, 0)>() {
+            details::join_to(this->text, {}, {strings.sv()...});
+            this->update_length();
         }
     };
     template <StringType separator, StringType... strings>
-    struct Join : details::BaseString<(decltype(strings)::SIZE + ...) + (sizeof...(strings) - 1) * decltype(separator)::SIZE> {
-        template <size_t I, size_t NextI, size_t... Is>
-        constexpr auto add_separator(size_t offset) {
-            std::copy_n(separator.text, separator.size, this->text + offset + I);
-            add_separator<NextI, Is...>(offset + separator.size + I);
-        }
-        template <size_t I>
-        constexpr auto add_separator(size_t) 
-        {}
-        constexpr Join() : details::BaseString<(strings.size + ...) + (sizeof...(strings) - 1) * separator.size>() {
-            size_t offset = 0;
-            ((std::copy_n(strings.text, strings.size, this->text + offset), offset += strings.size+separator.size), ...);
-            
-                add_separator<strings.size...>(0);
+    struct Join : details::BaseString<details::joined_size({decltype(strings)::SIZE...}, decltype(separator)::SIZE)> {
+        constexpr Join() : details::BaseString<details::joined_size({decltype(strings)::SIZE...}, decltype(separator)::SIZE)>() {
+            details::join_to(this->text, separator.sv(), {strings.sv()...});
+            this->update_length();
         }
     };
     template <StringType separator, StringType strings>
@@ -109,24 +126,21 @@ namespace strlit {
         static constexpr auto count_separator() -> size_t {
             size_t count = 0;
             auto str = strings.sv();
-            auto pos = str.find(separator.sv());
-            while (pos != std::string_view::npos) {
+            for (auto pos = str.find(separator.sv()); pos != std::string_view::npos; pos = str.find(separator.sv(), pos + separator.size)) {
                 count++;
-                pos = str.find(separator.sv(), pos + separator.size);
             }
             return count;
         }
         std::array<std::string_view, count_separator()+1> splitted;
         constexpr Split() {
             auto str = strings.sv();
-            auto pos = str.find(separator.sv());
+            size_t prev_pos = 0;
             size_t i = 0;
-            while (pos != std::string_view::npos) {
-                splitted[i++] = str.substr(0, pos);
-                str = str.substr(pos + separator.size);
-                pos = str.find(separator.sv());
+            for (auto pos = str.find(separator.sv()); pos != std::string_view::npos; pos = str.find(separator.sv(), prev_pos)) {
+                splitted[i++] = str.substr(prev_pos, pos - prev_pos);
+                prev_pos = pos + separator.size;
             }
-            splitted[i] = str;
+            splitted[i] = str.substr(prev_pos);
         }
         constexpr auto operator[](size_t i) const {
             return splitted[i];
@@ -140,6 +154,7 @@ namespace strlit {
         constexpr Reverse() : details::BaseString<strings.size>() {
             std::copy_n(strings.text, strings.size, this->text);
             std::reverse(this->text, this->text + strings.size);
+            this->update_length();
         }
     };
     namespace details {
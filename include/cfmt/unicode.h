@@ -0,0 +1,128 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include "details/simd.h"
+
+namespace cfmt::details {
+    /// Length of the ASCII prefix of [begin, end), checked a word or a vector at a time at runtime.
+    constexpr auto ascii_prefix_length(const char* begin, const char* end) -> size_t {
+        auto it = begin;
+        if (!std::is_constant_evaluated()) {
+#if defined(__AVX2__)
+            for (; end - it >= 32; it += 32) {
+                auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+                if (auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(chunk)); mask != 0) {
+                    return static_cast<size_t>(it - begin) + static_cast<size_t>(std::countr_zero(mask));
+                }
+            }
+#elif defined(CFMT_SSE2)
+            for (; end - it >= 16; it += 16) {
+                auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+                if (auto mask = static_cast<uint32_t>(_mm_movemask_epi8(chunk)); mask != 0) {
+                    return static_cast<size_t>(it - begin) + static_cast<size_t>(std::countr_zero(mask));
+                }
+            }
+#elif defined(CFMT_NEON)
+            for (; end - it >= 16; it += 16) {
+                if (vmaxvq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(it))) >= 0x80) {
+                    break;
+                }
+            }
+#endif
+            for (; end - it >= 8; it += 8) {
+                uint64_t word;
+                std::memcpy(&word, it, sizeof(word));
+                if ((word & 0x8080808080808080u) != 0) {
+                    break;
+                }
+            }
+        }
+        while (it != end && static_cast<unsigned char>(*it) < 0x80) {
+            ++it;
+        }
+        return static_cast<size_t>(it - begin);
+    }
+
+    /// Display width of a code point: 0 for the combining marks, which join the previous character,
+    /// 2 for the East Asian wide and fullwidth characters, 1 otherwise.
+    constexpr auto code_point_width(uint32_t cp) -> size_t {
+        if ((cp >= 0x0300 && cp <= 0x036f) ||     // combining diacritical marks
+            (cp >= 0x1ab0 && cp <= 0x1aff) ||     // combining diacritical marks extended
+            (cp >= 0x1dc0 && cp <= 0x1dff) ||     // combining diacritical marks supplement
+            (cp >= 0x20d0 && cp <= 0x20ff) ||     // combining diacritical marks for symbols
+            (cp >= 0xfe20 && cp <= 0xfe2f)) {     // combining half marks
+            return 0;
+        }
+        return 1 + (cp >= 0x1100 &&
+            (cp <= 0x115f ||                      // Hangul Jamo init. consonants
+             cp == 0x2329 || cp == 0x232a ||      // angle brackets
+             (cp >= 0x2e80 && cp <= 0xa4cf && cp != 0x303f) || // CJK ... Yi
+             (cp >= 0xac00 && cp <= 0xd7a3) ||    // Hangul syllables
+             (cp >= 0xf900 && cp <= 0xfaff) ||    // CJK compatibility ideographs
+             (cp >= 0xfe10 && cp <= 0xfe19) ||    // vertical forms
+             (cp >= 0xfe30 && cp <= 0xfe6f) ||    // CJK compatibility forms
+             (cp >= 0xff00 && cp <= 0xff60) ||    // fullwidth forms
+             (cp >= 0xffe0 && cp <= 0xffe6) ||    // fullwidth signs
+             (cp >= 0x1f300 && cp <= 0x1f64f) ||  // pictographs and emoticons
+             (cp >= 0x1f900 && cp <= 0x1f9ff) ||  // supplemental pictographs
+             (cp >= 0x20000 && cp <= 0x2fffd) ||  // CJK extensions
+             (cp >= 0x30000 && cp <= 0x3fffd)));
+    }
+
+    /// Decodes the UTF-8 code point at `it` and advances `it` past it.
+    /// Invalid or truncated sequences are decoded one byte at a time as U+FFFD.
+    constexpr auto decode_utf8(const char*& it, const char* end) -> uint32_t {
+        constexpr uint32_t replacement = 0xfffd;
+        auto lead = static_cast<unsigned char>(*it++);
+        size_t length = lead >= 0xf0 ? 3 : lead >= 0xe0 ? 2 : lead >= 0xc0 ? 1 : 0;
+        if (lead < 0x80) {
+            return lead;
+        }
+        if (length == 0 || lead >= 0xf8 || static_cast<size_t>(end - it) < length) {
+            return replacement;
+        }
+        uint32_t cp = lead & (0x3f >> length);
+        for (size_t i = 0; i < length; ++i) {
+            auto byte = static_cast<unsigned char>(it[i]);
+            if ((byte & 0xc0) != 0x80) {
+                return replacement;
+            }
+            cp = (cp << 6) | (byte & 0x3f);
+        }
+        it += length;
+        return cp;
+    }
+
+    /// Number of columns taken by the UTF-8 text: code points are counted, East Asian wide ones twice and combining marks not at all.
+    constexpr auto display_width(std::string_view str) -> size_t {
+        auto it = str.data();
+        auto end = it + str.size();
+        size_t width = 0;
+        while (it != end) {
+            auto ascii = ascii_prefix_length(it, end);
+            width += ascii;
+            it += ascii;
+            if (it != end) {
+                width += code_point_width(decode_utf8(it, end));
+            }
+        }
+        return width;
+    }
+
+    /// Sink only counting the display width of the text written to it.
+    struct WidthCountingSink {
+        size_t width = 0;
+        constexpr auto append(std::string_view str) -> WidthCountingSink& {
+            width += display_width(str);
+            return *this;
+        }
+        constexpr auto append(size_t count, char) -> WidthCountingSink& {
+            width += count;
+            return *this;
+        }
+    };
+}
@@ -3,6 +3,7 @@
 #include <cfmt/format.h>
 #include <cfmt/formatter_container.h>
 #include <cfmt/formatter_map.h>
+#include <cfmt/print.h>
 #include <string_view>
 #include <tuple>
 
@@ -20,16 +21,19 @@ Map with padding: "{3: >30}"
 Map with integer in hex: {3:#x}
 )";
 static constexpr auto contained = std::array{std::array{1,2,3}, std::array{4,5,6}};
-static constexpr auto mapped = std::array{std::pair{"hello", 123}, std::pair{"world", 456}};
+static constexpr auto mapped = std::array{std::pair{strlit::String("hello"), 123}, std::pair{strlit::String("world"), 456}};
 
 
 int main(int argc, char** argv)
 {
-    static constexpr auto compile_time_value = strlit::Shrink<cfmt::format<300>(txt, 12345, "foo", contained, mapped)>{};
+    static constexpr auto compile_time_value = cfmt::format<txt, 12345, strlit::String("foo"), contained, mapped>();
     cout << "value constexpr:'" << compile_time_value.sv() << "'" << endl;
 
     auto runtime_value = cfmt::format_runtime(txt, 12345, "foo", contained, mapped);
-    cout << "value runtime:'" << runtime_value << "'" << endl;
+    cfmt::print("value runtime:'{}'\n", runtime_value);
+
+    auto compiled_value = cfmt::format_runtime(cfmt::compiled<txt>, 12345, "foo", contained, mapped);
+    cfmt::print("value compiled:'{}'\n", compiled_value);
     
     return 0;
 }
\ No newline at end of file
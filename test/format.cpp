@@ -0,0 +1,185 @@
+#include <cfloat>
+#include <charconv>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <locale>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <cfmt/format.h>
+#include "test.h"
+
+namespace {
+    template <class FormatT>
+    auto format_error_of(const FormatT& format_text, const auto&... args) -> std::string {
+        try {
+            cfmt::format_runtime(format_text, args...);
+        } catch (const cfmt::format_error& error) {
+            return error.what();
+        }
+        return "no error";
+    }
+    /// Checks the integer in all the bases against `std::to_chars`, and the size hints against the output.
+    template <std::integral T>
+    auto check_integer(T value, std::source_location location = std::source_location::current()) -> void {
+        const std::pair<std::string_view, int> bases[] = {{"{}", 10}, {"{:d}", 10}, {"{:b}", 2}, {"{:o}", 8}, {"{:x}", 16}};
+        for (auto [format_text, base] : bases) {
+            char expected[80];
+            auto end = std::to_chars(expected, std::end(expected), value, base).ptr;
+            auto text = cfmt::format_runtime(format_text, value);
+            test::check_equal(text, std::string_view(expected, end), location);
+            test::check(cfmt::formatted_size(format_text, value) == text.size(), text, location);
+        }
+    }
+    /// Checks the value formatted with the spec against `printf` with the same conversion, eg ".3e" and "%.3e".
+    auto check_printf(double value, std::string_view spec, std::source_location location = std::source_location::current()) -> void {
+        auto conversion = "%" + std::string(spec);
+        auto size = std::snprintf(nullptr, 0, conversion.c_str(), value);
+        std::string expected(static_cast<size_t>(size), '\0');
+        std::snprintf(expected.data(), expected.size() + 1, conversion.c_str(), value);
+        auto format_text = "{:" + std::string(spec) + "}";
+        test::check_equal(cfmt::format_runtime(std::string_view(format_text), value), expected, location);
+    }
+    /// Checks that the shortest representation of the value reads back as the same value.
+    auto check_round_trip(double value, std::source_location location = std::source_location::current()) -> void {
+        auto text = cfmt::format_runtime("{}", value);
+        auto parsed = std::strtod(text.c_str(), nullptr);
+        test::check(std::memcmp(&parsed, &value, sizeof(double)) == 0, text, location);
+    }
+}
+
+/// Format strings known at runtime are checked against the arguments while formatting.
+auto test::run_format() -> void {
+    check_equal(cfmt::format_runtime(std::string_view("{:x} {:>4}|{:.{}f}"), 255, "ab", 1.25, 1), "ff   ab|1.2");
+    check_equal(format_error_of(std::string_view("{:Q}"), 1), "invalid format spec");
+    check_equal(format_error_of(std::string_view("{:f}"), 1), "invalid presentation type for the argument");
+    check_equal(format_error_of(std::string_view("{0:{5}}"), 1), "dynamic width or precision must be an integer argument");
+    check_equal(format_error_of(std::string_view("{0:{1}}"), 1, "x"), "dynamic width or precision must be an integer argument");
+    check_equal(format_error_of(std::string_view("{0:.{1}f}"), 1.5, 2.0), "dynamic width or precision must be an integer argument");
+    check_equal(format_error_of(std::string_view("{1}"), 1), "argument index out of range");
+    check_equal(format_error_of(std::string_view("[{:.{}f}]"), 1.5, UINT64_MAX), "number is too big");
+    check_equal(format_error_of(std::string_view("[{:{}}]"), 1, UINT64_MAX), "number is too big");
+    check_equal(format_error_of(std::string_view("[{:{}}]"), 1, int64_t(1) << 40), "number is too big");
+    check_equal(format_error_of(cfmt::cached_format("{:Q}"), 1), "invalid format spec");
+    check_equal(format_error_of(std::string_view("{:.4294967297e}"), 1.5), "precision is too big");
+    check_equal(format_error_of(std::string_view("{:.2147483647f}"), 1.5), "precision is too big");
+    check_equal(format_error_of(std::string_view("[{:.{}e}]"), 1.5, INT32_MAX), "precision is too big");
+    check_equal(format_error_of(cfmt::cached_format("{:.99999999999g}"), 1.5), "precision is too big");
+
+    // dynamic width and precision of checked format strings
+    try {
+        cfmt::format_runtime("[{:.{}f}]", 1.5, UINT64_MAX);
+        check(false, "too big precision throws");
+    } catch (const cfmt::format_error& error) {
+        check_equal(error.what(), "number is too big");
+    }
+    check_equal(cfmt::format_runtime("[{:{}}]", 1, uint64_t(3)), "[1  ]");
+
+    // 'L' groups the same digits with the compiled format strings as with the runtime ones
+    cfmt::set_digit_grouping(cfmt::DigitGrouping::uniform(',', 3));
+    check_equal(cfmt::format_runtime(cfmt::compiled<"{:L}|{:>12L}">, 1234567, -1234), "1,234,567|      -1,234");
+    check_equal(cfmt::format_runtime(std::string_view("{:L}|{:>12L}"), 1234567, -1234), "1,234,567|      -1,234");
+    cfmt::set_digit_grouping(cfmt::DigitGrouping::from_locale(std::locale()));
+    try {
+        cfmt::format_runtime("[{:.{}g}]", 1.5, uint32_t(3'000'000'000));
+        check(false, "too big precision throws");
+    } catch (const cfmt::format_error& error) {
+        check_equal(error.what(), "precision is too big");
+    }
+
+    // floating point numbers: the shortest representation reads back as the same value,
+    // and the other presentation types give the digits of printf
+    const double values[] = {0.0, -0.0, 1.0, -1.0, 0.1, 1.0/3, 0.5, 2.5, 9.5, 1e23, 1e-7, 1e16, -123456.789,
+        123456789012345680.0, 5e-324, 1e-320, 2.225073858507201e-308, DBL_MIN, DBL_MAX, HUGE_VAL, -HUGE_VAL, NAN, -NAN};
+    const std::string_view specs[] = {"e", "E", "f", "F", "g", "G", "a", "A", ".0e", ".0f", ".0g", ".0a", "#.0e", "#.0f", "#.0g", "#.0a",
+        ".3e", ".3f", ".3g", ".3a", "+.17g", " .20e", ".40a", ".1100e", ".1074f", ".900g"};
+    for (auto value : values) {
+        if (std::isfinite(value)) {
+            check_round_trip(value);
+        }
+        for (auto spec : specs) {
+            check_printf(value, spec);
+        }
+    }
+    check_equal(cfmt::format_runtime("{} {} {} {} {}", 0.0, -0.0, 5e-324, HUGE_VAL, -NAN), "0 -0 5e-324 inf -nan");
+    check_equal(cfmt::format_runtime("{} {} {}", 0.1, 1e23, DBL_MAX), "0.1 1e+23 1.7976931348623157e+308");
+    check_equal(cfmt::format_runtime("{} {:.3e} {:a}", 0.1f, 1.5f, 0.1f), "0.1 1.500e+00 0x1.99999ap-4");
+    // pseudo-random bit patterns, to cover all the exponents
+    uint64_t bits = 88172645463325252u;
+    const std::string_view random_specs[] = {".0e", ".5e", ".16e", ".0f", ".5f", ".0g", ".6g", ".17g", ".3a", "a"};
+    for (auto i = 0; i < 20000; ++i) {
+        bits ^= bits << 13;
+        bits ^= bits >> 7;
+        bits ^= bits << 17;
+        double value;
+        std::memcpy(&value, &bits, sizeof(double));
+        if (!std::isfinite(value)) {
+            continue;
+        }
+        check_round_trip(value);
+        auto spec = random_specs[i % std::size(random_specs)];
+        if (spec.find('f') == std::string_view::npos || std::fabs(value) < 1e30) {
+            check_printf(value, spec);
+        }
+    }
+
+    // integers: the limits, the digit count boundaries of each base, and the sign and prefix with zero padding
+    check_equal(cfmt::format_runtime("{} {}", INT64_MIN, INT64_MAX), "-9223372036854775808 9223372036854775807");
+    check_equal(cfmt::format_runtime("{:#x} {:#b} {:#X}", INT64_MIN, int8_t(-128), UINT64_MAX), "-0x8000000000000000 -0b10000000 0XFFFFFFFFFFFFFFFF");
+    check_equal(cfmt::format_runtime("{:#o} {:#o} {:#o} {:#x} {:#b}", 0, 8, -8, 0, 0), "0 010 -010 0x0 0b0");
+    check_equal(cfmt::format_runtime("[{:+08}] [{: 06}] [{:08}] [{:05}]", 42, 42, INT64_MIN, -7), "[+0000042] [ 00042] [-9223372036854775808] [-0007]");
+    check_equal(cfmt::format_runtime("[{:#010x}] [{:+#010x}] [{:#012b}] [{:#06o}] [{:#06X}]", 255, 255, -5, 8, 0xab), "[0x000000ff] [+0x00000ff] [-0b000000101] [000010] [0X00AB]");
+    // zero padding is ignored with an alignment
+    check_equal(cfmt::format_runtime("[{:<+08}] [{:>#08x}]", 7, 255), "[+7      ] [    0xff]");
+    check_equal(cfmt::format_runtime(cfmt::compiled<"{:+#012b}|{:#o}">, INT8_MIN, 0u), "-0b010000000|0");
+    check_integer(INT64_MIN);
+    check_integer(INT64_MAX);
+    check_integer(UINT64_MAX);
+    check_integer(INT32_MIN);
+    check_integer(int8_t(-128));
+    check_integer(uint8_t(255));
+    check_integer(int16_t(-32768));
+    uint64_t power = 1;
+    for (auto i = 0; i < 64; ++i, power *= 2) {
+        check_integer(power);
+        check_integer(power - 1);
+        check_integer(-static_cast<int64_t>(power - 1));
+    }
+    power = 1;
+    for (auto i = 0; i < 20; ++i, power *= 10) {
+        check_integer(power);
+        check_integer(power - 1);
+        check_integer(power + 1);
+        check_integer(static_cast<uint32_t>(power - 1));
+        check_integer(-static_cast<int64_t>(power / 10));
+    }
+
+    // named arguments: looked up by name in every kind of format string, and also positional
+    std::string user = "ada";
+    check_equal(cfmt::format_runtime("{user} took {ms}ms", cfmt::arg<"user">(user), cfmt::arg<"ms">(42)), "ada took 42ms");
+    check_equal(cfmt::format_runtime(std::string_view("{ms}/{user}/{ms:x}"), cfmt::arg<"user">(user), cfmt::arg<"ms">(42)), "42/ada/2a");
+    check_equal(cfmt::format_runtime(cfmt::compiled<"[{user:>{width}}|{width}]">, cfmt::arg<"user">(user), cfmt::arg<"width">(5)), "[  ada|5]");
+    check_equal(cfmt::format_runtime(std::string_view("[{v:.{p}f}]"), cfmt::arg<"v">(1.25), cfmt::arg<"p">(1)), "[1.2]");
+    // the automatic indices skip the named fields, and the named arguments keep their position
+    check_equal(cfmt::format_runtime("{} {n} {} {0} {2}", 1, cfmt::arg<"n">(2), 3), "1 2 2 1 3");
+    check_equal(cfmt::format_runtime(std::string_view("{} {n} {} {0} {2}"), 1, cfmt::arg<"n">(2), 3), "1 2 2 1 3");
+    check_equal(cfmt::format_runtime(cfmt::compiled<"{} {n} {} {0} {2}">, 1, cfmt::arg<"n">(2), 3), "1 2 2 1 3");
+    check_equal(cfmt::format_runtime(cfmt::cached_format("{} {n} {} {0} {2}"), 1, cfmt::arg<"n">(2), 3), "1 2 2 1 3");
+    // unknown names throw at runtime and fail the build of the checked format strings
+    check_equal(format_error_of(std::string_view("{nope}"), cfmt::arg<"n">(2)), "unknown argument name in format string");
+    check_equal(format_error_of(std::string_view("{:{w}}"), 1, cfmt::arg<"n">(2)), "unknown argument name in format string");
+    check_equal(format_error_of(cfmt::cached_format("{n} {nope}"), cfmt::arg<"n">(2)), "unknown argument name in format string");
+    check_equal(format_error_of(std::string_view("{n}"), 2), "unknown argument name in format string");
+    using NamedInt = decltype(cfmt::arg<"n">(2));
+    static_assert(std::string_view(cfmt::details::check_format<NamedInt>("{nope}")) == "unknown argument name in format string");
+    static_assert(std::string_view(cfmt::details::check_format<NamedInt, NamedInt>("{n}")) == "duplicate argument name");
+    using NamedString = decltype(cfmt::arg<"s">(user));
+    static_assert(std::string_view(cfmt::details::check_format<NamedInt, NamedString>("{n:{s}}")) == "dynamic width or precision must be an integer argument");
+    static_assert(cfmt::details::check_format<std::string, NamedInt>("{0:>{n}} {n:x} {}") == nullptr);
+}
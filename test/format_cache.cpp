@@ -0,0 +1,89 @@
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <cfmt/format.h>
+#include <cfmt/format_cache.h>
+#include "test.h"
+
+namespace {
+    /// True if the handles share the same parsed format string, ie the second lookup hit the cache.
+    auto same_parse(const cfmt::cached_format& a, const cfmt::cached_format& b) -> bool {
+        return &a.parsed() == &b.parsed();
+    }
+}
+
+auto test::run_format_cache() -> void {
+    // hits share the parse of the first lookup, misses parse the format string
+    cfmt::format_cache cache(8, 2);
+    auto first = cache.get("{} + {} = {}");
+    check(same_parse(first, cache.get("{} + {} = {}")), "hit");
+    check(!same_parse(first, cache.get("{} - {} = {}")), "miss");
+    check(cache.size() == 2, "two format strings");
+    check_equal(cfmt::format_runtime(first, 1, 2, 3), "1 + 2 = 3");
+    check_equal(cfmt::format_runtime(cache.get("{user}: {0:>4}"), cfmt::arg<"user">(7)), "7:    7");
+    try {
+        cache.get("{:Q");
+        check(false, "invalid format string throws");
+    } catch (const cfmt::format_error&) {
+        check(cache.size() == 3, "invalid format strings are not cached");
+    }
+    cache.clear();
+    check(cache.size() == 0, "cleared");
+    check(!same_parse(first, cache.get("{} + {} = {}")), "miss after clear");
+    check_equal(cfmt::format_runtime(first, 4, 5, 9), "4 + 5 = 9");
+
+    // CLOCK eviction in a shard of 3: the format strings looked up since the last pass of the hand are kept
+    cfmt::format_cache clock(3, 1);
+    auto a = clock.get("a{}");
+    auto b = clock.get("b{}");
+    auto c = clock.get("c{}");
+    check(same_parse(a, clock.get("a{}")), "a referenced");
+    auto d = clock.get("d{}");
+    check(clock.size() == 3, "full");
+    check(same_parse(a, clock.get("a{}")), "a got a second chance");
+    check(same_parse(c, clock.get("c{}")), "c kept");
+    check(same_parse(d, clock.get("d{}")), "d inserted");
+    // b was evicted, but its handle stays valid. a, c and d are all referenced again, so the hand
+    // clears them in a full pass from c and evicts c
+    check_equal(cfmt::format_runtime(b, 1), "b1");
+    check(!same_parse(b, clock.get("b{}")), "b evicted");
+    check(clock.size() == 3, "still full");
+    check(same_parse(a, clock.get("a{}")), "a kept");
+    check(same_parse(d, clock.get("d{}")), "d kept");
+    check(!same_parse(c, clock.get("c{}")), "c evicted after a full pass");
+
+    // capacity pressure: the cache stays at about its capacity, and the evicted handles stay valid
+    cfmt::format_cache small(10, 4);
+    std::vector<cfmt::cached_format> handles;
+    for (int i = 0; i < 200; ++i) {
+        handles.push_back(small.get("#" + std::to_string(i) + " {}"));
+        check(small.size() <= 12, "at most the capacity rounded up to the shards");
+    }
+    for (int i = 0; i < 200; i += 37) {
+        check_equal(cfmt::format_runtime(handles[i], i), "#" + std::to_string(i) + " " + std::to_string(i));
+    }
+
+    // concurrent lookups, insertions and evictions
+    cfmt::format_cache shared(16, 4);
+    std::vector<std::thread> threads;
+    std::vector<int> failures(4, 0);
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 2000; ++i) {
+                auto key = (i * 7 + t) % 40;
+                auto text = cfmt::format_runtime(shared.get("[{}] " + std::to_string(key)), t);
+                if (text != "[" + std::to_string(t) + "] " + std::to_string(key)) {
+                    ++failures[t];
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto count : failures) {
+        check(count == 0, "concurrent formatting");
+    }
+    check(shared.size() <= 16, "capacity under concurrent insertions");
+}
@@ -0,0 +1,90 @@
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cfmt/format.h>
+#include <cfmt/formatter_bytes.h>
+#include "test.h"
+
+namespace {
+    /// Dump written a byte at a time with printf, as `ByteDump` documents it.
+    auto reference_dump(const std::vector<uint8_t>& data, char type, size_t group, std::string_view separator, bool lines) -> std::string {
+        std::string result;
+        auto line = lines ? size_t(16) : data.size();
+        for (size_t offset = 0; offset < data.size(); offset += line) {
+            char text[16];
+            if (lines) {
+                if (offset != 0) {
+                    result += '\n';
+                }
+                std::snprintf(text, sizeof(text), type == 'X' ? "%08zX: " : "%08zx: ", offset);
+                result += text;
+            }
+            for (auto i = offset; i < data.size() && i < offset + line; ++i) {
+                if (i != offset && group != 0 && (i - offset) % group == 0) {
+                    result += separator;
+                }
+                if (type == 'b') {
+                    for (int bit = 7; bit >= 0; --bit) {
+                        result += static_cast<char>('0' + ((data[i] >> bit) & 1));
+                    }
+                } else {
+                    std::snprintf(text, sizeof(text), type == 'X' ? "%02X" : "%02x", data[i]);
+                    result += text;
+                }
+            }
+        }
+        return result;
+    }
+}
+
+auto test::run_formatter_bytes() -> void {
+    const uint8_t payload[] = {0x0a, 0xff, 0x00, 0x7e, 0x80};
+    check_equal(cfmt::format_runtime("{}", cfmt::bytes(payload)), "0aff007e80");
+    check_equal(cfmt::format_runtime("{:.2X|:|}", cfmt::bytes(payload)), "0AFF:007E:80");
+    check_equal(cfmt::format_runtime("{:.1b}", cfmt::bytes(payload)), "00001010 11111111 00000000 01111110 10000000");
+    check_equal(cfmt::format_runtime("{:.3B|, |}", cfmt::bytes(payload)), "000010101111111100000000, 0111111010000000");
+    check_equal(cfmt::format_runtime("{:#.4x}", cfmt::bytes(payload)), "00000000: 0aff007e 80");
+    check_equal(cfmt::format_runtime("[{:*^14.2}]", cfmt::bytes(payload)), "[*0aff 007e 80*]");
+    check_equal(cfmt::format_runtime("[{:>4}]", cfmt::bytes(std::string_view())), "[    ]");
+    const std::array<std::byte, 3> raw = {std::byte{1}, std::byte{0xab}, std::byte{0xcd}};
+    check_equal(cfmt::format_runtime("{:X}", raw), "01ABCD");
+    check_equal(cfmt::format_runtime(cfmt::compiled<"{:.2x|-|}">, cfmt::bytes(std::string_view("abc"))), "6162-63");
+
+    // group sizes on both sides of the small group path, separators up to beyond the buffer, and lines
+    // of 16 bytes with their offset, on sizes crossing the 64 bytes blocks and the 512 bytes buffer
+    std::vector<uint8_t> data(1200);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(i * 131 + 7);
+    }
+    const std::string long_separator(600, '.');
+    for (size_t size : {0, 1, 15, 16, 17, 63, 64, 65, 257, 1200}) {
+        auto values = std::vector<uint8_t>(data.begin(), data.begin() + static_cast<ptrdiff_t>(size));
+        for (char type : {'x', 'X', 'b'}) {
+            for (size_t group : {0, 1, 2, 3, 4, 5, 16, 17, 40}) {
+                for (std::string_view separator : {std::string_view(" "), std::string_view(""), std::string_view(" : "), std::string_view(long_separator)}) {
+                    for (bool lines : {false, true}) {
+                        auto format_text = std::string("{:") + (lines ? "#" : "") + (group != 0 ? "." + std::to_string(group) : "")
+                            + type + "|" + std::string(separator) + "|}";
+                        auto expected = reference_dump(values, type, group, separator, lines);
+                        auto text = cfmt::format_runtime(std::string_view(format_text), cfmt::bytes(values));
+                        check_equal(text, expected);
+                        check(cfmt::formatted_size(std::string_view(format_text), cfmt::bytes(values)) == expected.size(), format_text);
+                    }
+                }
+            }
+        }
+    }
+
+    // the offsets beyond 4 GiB take more than 8 digits, for all the lines
+    cfmt::FormatDescriptor desc;
+    desc.numb_prefix = true;
+    size_t line_count = size_t(1) << 29;
+    auto dump = cfmt::details::ByteDump<uint8_t>(nullptr, line_count * 16, desc);
+    check(dump.offset_size() == 11, "9 offset digits and \": \"");
+    check(dump.formatted_size() == line_count * (32 + 11) + line_count - 1, "size of the dump beyond 4 GiB");
+    check(cfmt::details::ByteDump<uint8_t>(nullptr, size_t(1) << 32, desc).offset_size() == 10, "8 offset digits up to 4 GiB");
+}
@@ -0,0 +1,47 @@
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <cfmt/format.h>
+#include <cfmt/format_cache.h>
+#include <cfmt/formatter_chrono.h>
+#include "test.h"
+
+namespace {
+    template <class FormatT>
+    auto format_error_of(const FormatT& format_text, const auto&... args) -> std::string {
+        try {
+            cfmt::format_runtime(format_text, args...);
+        } catch (const cfmt::format_error& error) {
+            return error.what();
+        }
+        return "no error";
+    }
+}
+
+/// Runtime chrono specs are checked like the ones known at compile time, and the precision limits the sub-second digits.
+auto test::run_formatter_chrono() -> void {
+    using namespace std::chrono;
+    auto time = sys_seconds(seconds(1700000000)) + nanoseconds(123456789);
+    check_equal(cfmt::format_runtime("{}", time), "2023-11-14 22:13:20.123456789");
+    check_equal(cfmt::format_runtime("{:.3}", time), "2023-11-14 22:13:20.123");
+    check_equal(cfmt::format_runtime(std::string_view("{:.0%T}"), time), "22:13:20");
+    check_equal(cfmt::format_runtime(std::string_view("{:.{}%S}"), time, 2), "20.12");
+    check_equal(cfmt::format_runtime("{:.12%S}", time), "20.123456789");
+    check_equal(cfmt::format_runtime(cfmt::compiled<"{:.6%T}">, time), "22:13:20.123456");
+
+    // the padding counts the display columns: "µ" is two bytes but one column
+    check_equal(cfmt::format_runtime("{:>6}", 42us), "  42µs");
+    check_equal(cfmt::format_runtime(std::string_view("{:*<8%Q%q}"), 42us), "42µs****");
+    check_equal(cfmt::format_runtime("{:>12%a %b}", time), "     Tue Nov");
+
+    check_equal(format_error_of(std::string_view("{:%Q}"), time), "invalid conversion specifier for the argument");
+    check_equal(format_error_of(cfmt::cached_format("{:%F %Q}"), time), "invalid conversion specifier for the argument");
+    check_equal(format_error_of(std::string_view("{:%F %}"), time), "missing conversion specifier after '%'");
+    check_equal(format_error_of(std::string_view("{:%F}"), 42ms), "invalid conversion specifier for the argument");
+    try {
+        cfmt::Formatter<sys_seconds>{}.parse("%Y %Q");
+        check(false, "unknown conversion specifier throws");
+    } catch (const cfmt::format_error& error) {
+        check_equal(error.what(), "invalid conversion specifier for the argument");
+    }
+}
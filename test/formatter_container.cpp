@@ -0,0 +1,55 @@
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+#include <cfmt/format.h>
+#include <cfmt/formatter_container.h>
+#include <cfmt/formatter_map.h>
+#include <cfmt/memory_buffer.h>
+#include "test.h"
+
+namespace {
+    struct Point {
+        int x;
+        int y;
+    };
+}
+/// User formatter without `presentation_types`: its specs are not checked by the containers.
+template <>
+struct cfmt::Formatter<Point> {
+    constexpr auto parse(std::string_view input) const -> FormatDescriptor {
+        FormatDescriptor desc;
+        desc.parse(input.begin(), input.end());
+        return desc;
+    }
+    auto format(const Point& point, const FormatDescriptor&) const -> std::string {
+        return cfmt::format_runtime("({}; {})", point.x, point.y);
+    }
+};
+
+/// Padded ranges and maps are padded as a whole, by their display width.
+auto test::run_formatter_container() -> void {
+    auto values = std::array{1, 22, 333};
+    check_equal(cfmt::format_runtime("{}", values), "{1, 22, 333}");
+    check_equal(cfmt::format_runtime("{:*^16}", values), "**{1, 22, 333}**");
+    check_equal(cfmt::format_runtime("{:>14x}", values), "  {1, 16, 14d}");
+    check_equal(cfmt::format_runtime("{:4}", values), "{1, 22, 333}");
+    check_equal(cfmt::format_runtime("{:>9}", std::vector<std::string>{"é", "日本"}), "{é, 日本}");
+    check_equal(cfmt::format_runtime("{:>11}", std::vector<std::string>{"é", "日本"}), "  {é, 日本}");
+    check_equal(cfmt::format_runtime(cfmt::compiled<"{:<14}|">, values), "{1, 22, 333}  |");
+    static_assert(cfmt::formatted_size("{:^20}", std::array{1, 22, 333}) == 20);
+
+    cfmt::memory_buffer<8> buffer;
+    cfmt::format_to(buffer, "{:>14}|{:<10}", values, std::vector<std::string>{"é", "日本"});
+    check_equal(buffer.sv(), "  {1, 22, 333}|{é, 日本} ");
+
+    auto map = std::map<std::string, int>{{"a", 1}, {"b", 22}};
+    check_equal(cfmt::format_runtime("{}", map), "{a: 1, b: 22}");
+    check_equal(cfmt::format_runtime("{:->17}", map), "----{a: 1, b: 22}");
+    check_equal(cfmt::format_runtime("{:^#19x}", map), " {a: 0x1, b: 0x16} ");
+
+    auto points = std::vector<Point>{{1, 2}, {3, 4}};
+    check_equal(cfmt::format_runtime("{}", points), "{(1; 2), (3; 4)}");
+    check_equal(cfmt::format_runtime(std::string_view("{:>18}"), points), "  {(1; 2), (3; 4)}");
+    check_equal(cfmt::format_runtime("{}", std::map<std::string, Point>{{"a", {5, 6}}}), "{a: (5; 6)}");
+}
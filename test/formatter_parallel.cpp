@@ -0,0 +1,37 @@
+#include <string>
+#include <vector>
+#include <cfmt/format.h>
+#include <cfmt/formatter_parallel.h>
+#include <cfmt/memory_buffer.h>
+#include "test.h"
+
+namespace {
+    /// The parallel formatting must write the same text as the range formatter, with any thread count.
+    template <class T>
+    auto check_same(const std::vector<T>& values, std::string_view format_text) -> void {
+        auto expected = cfmt::format_runtime(format_text, values);
+        for (unsigned threads : {1u, 2u, 3u}) {
+            auto options = cfmt::ParallelOptions{.min_size = 2, .threads = threads};
+            test::check_equal(cfmt::format_runtime(format_text, cfmt::parallel(values, options)), expected);
+
+            cfmt::memory_buffer<16> buffer;
+            buffer.append("<");
+            cfmt::format_to(buffer, format_text, cfmt::parallel(values, options));
+            test::check_equal(buffer.sv(), "<" + expected);
+        }
+    }
+}
+
+auto test::run_formatter_parallel() -> void {
+    std::vector<int> integers;
+    for (int i = -50; i < 50; ++i) {
+        integers.push_back(i * 7919);
+    }
+    check_same(integers, "{}");
+    check_same(integers, "{:#x}");
+    check_same(integers, "{:*^1000}");
+    check_same(std::vector<std::string>{"é", "ab", "日本", "c"}, "{:>20}");
+    // without size hints, the chunks are formatted into their own strings
+    check_same(std::vector<double>{0.5, -1.25, 3.0, 1e10, 7.0}, "{}");
+    check_same(std::vector<double>{0.5, -1.25, 3.0, 1e10, 7.0}, "{:>40}");
+}
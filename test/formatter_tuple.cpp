@@ -0,0 +1,54 @@
+#include <array>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <cfmt/format.h>
+#include <cfmt/formatter_container.h>
+#include <cfmt/formatter_tuple.h>
+#include "test.h"
+
+namespace {
+    struct Point {
+        int x;
+        int y;
+    };
+    struct Named {
+        std::string name;
+        Point position;
+        std::array<int, 2> size;
+    };
+    struct View {
+        std::string_view name;
+        int id;
+    };
+    struct WithArray {
+        int values[3];
+    };
+    struct WithArrayAndField {
+        int id;
+        char tag[4];
+    };
+    struct Empty {};
+    struct WithEmptyBase : Empty {
+        int x;
+    };
+    struct WithBase : Point {
+        int z;
+    };
+
+    static_assert(cfmt::IsFormatable<Point>);
+    static_assert(cfmt::IsFormatable<Named>);
+    static_assert(cfmt::IsFormatable<View>);
+    // aggregates with a base or an array member are not formattable, rather than failing to compile
+    static_assert(!cfmt::IsFormatable<WithArray>);
+    static_assert(!cfmt::IsFormatable<WithArrayAndField>);
+    static_assert(!cfmt::IsFormatable<WithEmptyBase>);
+    static_assert(!cfmt::IsFormatable<WithBase>);
+}
+
+auto test::run_formatter_tuple() -> void {
+    check_equal(cfmt::format_runtime("{}", Point{1, 2}), "{1, 2}");
+    check_equal(cfmt::format_runtime("{}", std::tuple{1, "a"}), "(1, a)");
+    check_equal(cfmt::format_runtime("{}", View{"request", 7}), "{request, 7}");
+    check_equal(cfmt::format_runtime("{}", Named{"box", {3, 4}, {5, 6}}), "{box, {3, 4}, {5, 6}}");
+}
@@ -0,0 +1,26 @@
+#include "test.h"
+
+auto test::fail_count() -> int& {
+    static int count = 0;
+    return count;
+}
+
+/// Usage: cfmt-test, exits with 1 if a check failed.
+int main()
+{
+    test::run_format();
+    test::run_print();
+    test::run_formatter_chrono();
+    test::run_formatter_container();
+    test::run_formatter_tuple();
+    test::run_formatter_parallel();
+    test::run_formatter_bytes();
+    test::run_format_cache();
+    test::run_unicode();
+    if (test::fail_count() != 0) {
+        std::printf("%d checks failed\n", test::fail_count());
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}
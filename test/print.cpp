@@ -0,0 +1,47 @@
+#include <cstdio>
+#include <string>
+#include <cfmt/print.h>
+#include "test.h"
+
+namespace {
+    auto read_all(std::FILE* file) -> std::string {
+        std::fflush(file);
+        std::rewind(file);
+        std::string result;
+        char buffer[256];
+        while (auto count = std::fread(buffer, 1, sizeof(buffer), file)) {
+            result.append(buffer, count);
+        }
+        return result;
+    }
+    auto throws_format_error(auto&& fn) -> bool {
+        try {
+            fn();
+        } catch (const cfmt::format_error&) {
+            return true;
+        }
+        return false;
+    }
+}
+
+/// The text of a print whose formatting throws is not written by the next prints.
+auto test::run_print() -> void {
+    {
+        auto file = std::tmpfile();
+        check(throws_format_error([&] { cfmt::print(file, std::string_view("partial {} {1}\n"), 1); }), "print throws");
+        cfmt::print(file, "next line {}\n", 2);
+        check_equal(read_all(file), "next line 2\n");
+        std::fclose(file);
+    }
+    {
+        auto file = std::tmpfile();
+        {
+            cfmt::PrintBatch batch;
+            cfmt::print(file, "first {}\n", 1);
+            check(throws_format_error([&] { cfmt::print(file, std::string_view("partial {} {1}\n"), 2); }), "batched print throws");
+            cfmt::print(file, "last {}\n", 3);
+        }
+        check_equal(read_all(file), "first 1\nlast 3\n");
+        std::fclose(file);
+    }
+}
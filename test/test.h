@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdio>
+#include <source_location>
+#include <string_view>
+
+/// Minimal test harness: a failed check reports its location and the test run fails.
+namespace test {
+    auto fail_count() -> int&;
+
+    inline auto check(bool condition, std::string_view what, std::source_location location = std::source_location::current()) -> void {
+        if (!condition) {
+            ++fail_count();
+            std::printf("%s:%u: check failed: %.*s\n", location.file_name(), static_cast<unsigned>(location.line()),
+                static_cast<int>(what.size()), what.data());
+        }
+    }
+    inline auto check_equal(std::string_view actual, std::string_view expected, std::source_location location = std::source_location::current()) -> void {
+        if (actual != expected) {
+            ++fail_count();
+            std::printf("%s:%u: expected \"%.*s\", got \"%.*s\"\n", location.file_name(), static_cast<unsigned>(location.line()),
+                static_cast<int>(expected.size()), expected.data(), static_cast<int>(actual.size()), actual.data());
+        }
+    }
+
+    auto run_format() -> void;
+    auto run_print() -> void;
+    auto run_formatter_chrono() -> void;
+    auto run_formatter_container() -> void;
+    auto run_formatter_tuple() -> void;
+    auto run_formatter_parallel() -> void;
+    auto run_formatter_bytes() -> void;
+    auto run_format_cache() -> void;
+    auto run_unicode() -> void;
+}
@@ -0,0 +1,61 @@
+#include <string>
+#include <string_view>
+#include <cfmt/format.h>
+#include <cfmt/unicode.h>
+#include "test.h"
+
+namespace {
+    /// Display width computed one byte at a time, without the vectorized ASCII prefix.
+    auto scalar_width(std::string_view str) -> size_t {
+        auto it = str.data();
+        auto end = it + str.size();
+        size_t width = 0;
+        while (it != end) {
+            width += cfmt::details::code_point_width(cfmt::details::decode_utf8(it, end));
+        }
+        return width;
+    }
+}
+
+/// The padding counts the display columns of the UTF-8 text.
+auto test::run_unicode() -> void {
+    using cfmt::details::display_width;
+    check(display_width("") == 0, "empty");
+    check(display_width("abc") == 3, "ascii");
+    check(display_width("\xc3\xa9t\xc3\xa9") == 3, "2-byte sequences");
+    // wide CJK, Hangul, fullwidth forms and emoji take two columns
+    check(display_width("\xe6\x97\xa5\xe6\x9c\xac") == 4, "CJK");
+    check(display_width("\xed\x95\x9c") == 2, "Hangul");
+    check(display_width("\xef\xbc\xa1") == 2, "fullwidth A");
+    check(display_width("\xf0\x9f\x98\x80") == 2, "emoji");
+    check(display_width("\xf0\xa0\x80\x80") == 2, "CJK extension B");
+    // combining marks join the previous character
+    check(display_width("e\xcc\x81") == 1, "e + combining acute");
+    check(display_width("a\xcc\x8a\xcc\x81" "b") == 2, "two combining marks");
+    check(display_width("x\xe2\x83\x97") == 1, "combining vector arrow");
+    // invalid and truncated sequences take one column per byte
+    check(display_width("\x80") == 1, "lone continuation byte");
+    check(display_width("\xff\xfe") == 2, "invalid lead bytes");
+    check(display_width("a\xe6\x97") == 3, "truncated 3-byte sequence");
+    check(display_width("\xe6" "a") == 2, "lead byte followed by ascii");
+    check(display_width("\xf8\x88\x80\x80\x80") == 5, "5-byte sequence");
+
+    check_equal(cfmt::format_runtime("[{:>6}]", "\xe6\x97\xa5\xe6\x9c\xac"), "[  \xe6\x97\xa5\xe6\x9c\xac]");
+    check_equal(cfmt::format_runtime("[{:*^5}]", "e\xcc\x81"), "[**e\xcc\x81**]");
+    check_equal(cfmt::format_runtime("[{:<3}]", "\xff"), "[\xff  ]");
+    check_equal(cfmt::format_runtime(cfmt::compiled<"[{:>4}]">, "\xc3\xa9t\xc3\xa9"), "[ \xc3\xa9t\xc3\xa9]");
+    static_assert(display_width("\xe6\x97\xa5" "ab\xcc\x81") == 4);
+
+    // a non-ASCII character at each position of texts around the vector and word sizes,
+    // so that it falls in a vector, in a word or in the scalar tail
+    for (size_t size = 0; size <= 70; ++size) {
+        std::string ascii(size, 'a');
+        check(display_width(ascii) == size, ascii);
+        for (size_t i = 0; i < size; ++i) {
+            for (std::string_view code_point : {"\xc3\xa9", "\xe6\x97\xa5", "\x80"}) {
+                auto text = std::string(i, 'a') + std::string(code_point) + std::string(size - i, 'b');
+                check(display_width(text) == scalar_width(text), text);
+            }
+        }
+    }
+}
@@ -25,4 +25,49 @@ target("cfmt-example")
         else
             add_cxflags("/FA")
         end
-    end
\ No newline at end of file
+    end
+
+target("cfmt-bench")
+    set_kind("binary")
+    add_deps("cfmt")
+    set_languages("cxx20")
+    set_default(false)
+    add_files("bench/main.cpp", "bench/runtime.cpp", "bench/float.cpp", "bench/print.cpp", "bench/deferred.cpp", "bench/chrono.cpp", "bench/bytes.cpp", "bench/parallel.cpp")
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
+
+target("cfmt-test")
+    set_kind("binary")
+    add_deps("cfmt")
+    set_languages("cxx20")
+    set_default(false)
+    add_files("test/main.cpp", "test/format.cpp", "test/print.cpp", "test/formatter_chrono.cpp", "test/formatter_container.cpp", "test/formatter_tuple.cpp", "test/formatter_parallel.cpp", "test/formatter_bytes.cpp", "test/format_cache.cpp", "test/unicode.cpp")
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
+
+target("cfmt-compile-bench")
+    set_kind("phony")
+    add_deps("cfmt")
+    set_languages("cxx20")
+    set_default(false)
+    on_run(function (target)
+        import("compile_bench", {rootdir = path.join(os.projectdir(), "bench")})
+        compile_bench(target)
+    end)
+
+target("cfmt-codesize")
+    set_kind("binary")
+    add_deps("cfmt")
+    set_languages("cxx20")
+    set_default(false)
+    add_files("bench/codesize.cpp")
+
+target("cfmt-codesize-variadic")
+    set_kind("binary")
+    add_deps("cfmt")
+    set_languages("cxx20")
+    set_default(false)
+    add_files("bench/codesize.cpp")
+    add_defines("CFMT_VARIADIC_ARGS")